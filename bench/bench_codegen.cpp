@@ -0,0 +1,68 @@
+// the generated lexers of the demo grammar [src/main.cpp], see the bench_codegen target
+#include <Lexer.hpp>
+#include <benchmark/benchmark.h>
+#include <direct_lexer.hpp>
+#include <random>
+#include <table_lexer.hpp>
+
+static const std::string& getText()
+{
+    static const std::string text = [] {
+        const std::vector<std::string> words { "b", "c", ">", "<Leader>", "<Tab>" };
+        std::mt19937 rng { 1 };
+        std::string text {};
+        while (text.size() < (16 << 20))
+            text += words[rng() % words.size()];
+        return text;
+    }();
+    return text;
+}
+
+template <typename Tokenize>
+static void run(benchmark::State& state, Tokenize&& tokenize)
+{
+    const auto& text = getText();
+    std::size_t token_count = 0;
+    for (auto _ : state) {
+        token_count = 0;
+        tokenize(text, [&token_count](const auto& token) {
+            benchmark::DoNotOptimize(token);
+            ++token_count;
+        });
+    }
+    state.SetBytesProcessed(state.iterations() * text.size());
+    state.counters["tokens"] = benchmark::Counter(
+        static_cast<double>(state.iterations() * token_count), benchmark::Counter::kIsRate);
+}
+
+static void tableBackend(benchmark::State& state)
+{
+    run(state, [](std::string_view text, auto&& on_token) { table_lexer::tokenize(text, on_token); });
+}
+BENCHMARK(tableBackend);
+
+static void directBackend(benchmark::State& state)
+{
+    run(state, [](std::string_view text, auto&& on_token) { direct_lexer::tokenize(text, on_token); });
+}
+BENCHMARK(directBackend);
+
+static void runtimeLexer(benchmark::State& state)
+{
+    DFA dfa(NFA::fromRules({
+        {"<(Leader|Tab)>", { 4, "Key" }},
+        { "b",             { 2, "B" }  },
+        { "c",             { 3, "C" }  },
+        { ">",             { 5, ">" }  },
+    }));
+    dfa.minimal();
+
+    run(state, [&dfa](std::string_view text, auto&& on_token) {
+        Lexer lexer(Buffer { text }, dfa);
+        while (auto token = lexer.nextToken())
+            on_token(*token);
+    });
+}
+BENCHMARK(runtimeLexer);
+
+BENCHMARK_MAIN();
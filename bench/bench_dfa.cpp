@@ -0,0 +1,67 @@
+#include <DFA.hpp>
+#include <MappedDFA.hpp>
+#include <Synthetic.hpp>
+#include <benchmark/benchmark.h>
+#include <cstdio>
+
+static void subsetConstruction(benchmark::State& state)
+{
+    const auto nfa = NFA::fromRules(Synthetic::makeGrammar(state.range(0)));
+    nfa.buildClosureCache();
+    std::size_t state_count = 0;
+    for (auto _ : state) {
+        DFA dfa(nfa);
+        state_count = dfa.getStateCount();
+        benchmark::DoNotOptimize(dfa);
+    }
+    state.counters["states"] = state_count;
+}
+BENCHMARK(subsetConstruction)->Arg(10)->Arg(100)->Arg(300)->Unit(benchmark::kMillisecond);
+
+static void parallelSubsetConstruction(benchmark::State& state)
+{
+    const auto nfa = NFA::fromRules(Synthetic::makeGrammar(state.range(0)));
+    nfa.buildClosureCache();
+    for (auto _ : state) {
+        DFA dfa(nfa, state.range(1));
+        benchmark::DoNotOptimize(dfa);
+    }
+}
+BENCHMARK(parallelSubsetConstruction)
+    ->ArgsProduct({ { 100, 300 }, { 2, 4, 8 } })
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+static void minimal(benchmark::State& state)
+{
+    const DFA dfa(NFA::fromRules(Synthetic::makeGrammar(state.range(0))));
+    std::size_t state_count = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto copy = dfa;
+        state.ResumeTiming();
+
+        copy.minimal();
+        state_count = copy.getStateCount();
+        benchmark::DoNotOptimize(copy);
+    }
+    state.counters["states"] = state_count;
+}
+BENCHMARK(minimal)->Arg(10)->Arg(100)->Arg(300)->Unit(benchmark::kMillisecond);
+
+// loading a saved DFA instead of building it, arg 1: verify the checksum
+static void mappedLoad(benchmark::State& state)
+{
+    constexpr auto filename = "bench_mapped_dfa.bin";
+    DFA dfa(NFA::fromRules(Synthetic::makeGrammar(state.range(0))));
+    dfa.minimal();
+    dfa.saveBinaryTo(filename);
+    for (auto _ : state) {
+        MappedDFA mapped(filename, state.range(1));
+        benchmark::DoNotOptimize(mapped.isValid());
+    }
+    std::remove(filename);
+}
+BENCHMARK(mappedLoad)->ArgsProduct({ { 100, 1000 }, { 0, 1 } })->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,111 @@
+#include <Lexer.hpp>
+#include <PikeVM.hpp>
+#include <Synthetic.hpp>
+#include <benchmark/benchmark.h>
+#include <sstream>
+
+// INFO : range(0) is the rule count of the grammar, range(1) the input size
+
+static DFA buildDFA(std::size_t rule_count)
+{
+    DFA dfa(NFA::fromRules(Synthetic::makeGrammar(rule_count)));
+    dfa.minimal();
+    return dfa;
+}
+
+static std::string makeText(std::size_t rule_count, std::size_t size)
+{
+    return Synthetic::makeText(Synthetic::makeGrammar(rule_count), { .size = size });
+}
+
+static void setCounters(benchmark::State& state, std::size_t size, std::size_t token_count)
+{
+    state.SetBytesProcessed(state.iterations() * size);
+    state.counters["tokens"] = benchmark::Counter(
+        static_cast<double>(state.iterations() * token_count), benchmark::Counter::kIsRate);
+}
+
+static void nextToken(benchmark::State& state)
+{
+    const auto dfa = buildDFA(state.range(0));
+    const auto text = makeText(state.range(0), state.range(1));
+    std::size_t token_count = 0;
+    for (auto _ : state) {
+        Lexer lexer(Buffer { std::string_view { text } }, dfa);
+        token_count = 0;
+        while (auto token = lexer.nextToken()) {
+            benchmark::DoNotOptimize(token);
+            ++token_count;
+        }
+    }
+    setCounters(state, text.size(), token_count);
+}
+BENCHMARK(nextToken)->ArgsProduct({ { 10, 300 }, { 64 << 10, 16 << 20 } });
+
+static void tokenList(benchmark::State& state)
+{
+    const auto dfa = buildDFA(state.range(0));
+    const auto text = makeText(state.range(0), state.range(1));
+    TokenList tokens {};
+    for (auto _ : state) {
+        Lexer lexer(Buffer { std::string_view { text } }, dfa);
+        lexer.getAllTokens(tokens);
+    }
+    setCounters(state, text.size(), tokens.size());
+}
+BENCHMARK(tokenList)->ArgsProduct({ { 10, 300 }, { 64 << 10, 16 << 20 } });
+
+static void streamed(benchmark::State& state)
+{
+    const auto dfa = buildDFA(state.range(0));
+    const auto text = makeText(state.range(0), state.range(1));
+    TokenList tokens {};
+    for (auto _ : state) {
+        std::istringstream iss { text };
+        Lexer lexer(Buffer { iss }, dfa);
+        lexer.getAllTokens(tokens);
+    }
+    setCounters(state, text.size(), tokens.size());
+}
+BENCHMARK(streamed)->ArgsProduct({ { 10 }, { 16 << 20 } });
+
+static void parallel(benchmark::State& state)
+{
+    const auto dfa = buildDFA(10);
+    const auto text = makeText(10, 64 << 20);
+    TokenList tokens {};
+    for (auto _ : state) {
+        Lexer lexer(Buffer { std::string_view { text } }, dfa);
+        lexer.getAllTokens(tokens, state.range(0), '\n');
+    }
+    setCounters(state, text.size(), tokens.size());
+}
+BENCHMARK(parallel)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+static void lazy(benchmark::State& state)
+{
+    const auto nfa = NFA::fromRules(Synthetic::makeGrammar(state.range(0)));
+    const auto text = makeText(state.range(0), state.range(1));
+    TokenList tokens {};
+    for (auto _ : state) {
+        // the cache starts cold every time, as a lazy lexer would at startup
+        LazyLexer lexer(Buffer { std::string_view { text } }, LazyDFA { nfa });
+        lexer.getAllTokens(tokens);
+    }
+    setCounters(state, text.size(), tokens.size());
+}
+BENCHMARK(lazy)->ArgsProduct({ { 10, 300 }, { 64 << 10, 16 << 20 } });
+
+static void pikeVM(benchmark::State& state)
+{
+    const auto nfa = NFA::fromRules(Synthetic::makeGrammar(state.range(0)));
+    const auto text = makeText(state.range(0), state.range(1));
+    PikeVM vm { nfa };
+    TokenList tokens {};
+    for (auto _ : state)
+        vm.tokenize(text, tokens);
+    setCounters(state, text.size(), tokens.size());
+}
+BENCHMARK(pikeVM)->ArgsProduct({ { 10, 300 }, { 64 << 10 } });
+
+BENCHMARK_MAIN();
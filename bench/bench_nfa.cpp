@@ -0,0 +1,137 @@
+#include <NFA.hpp>
+#include <Synthetic.hpp>
+#include <Util.hpp>
+#include <benchmark/benchmark.h>
+#include <random>
+
+// the rules of a grammar of state.range(0) rules
+static std::vector<FSA::str_t> getRegexes(benchmark::State& state)
+{
+    std::vector<FSA::str_t> regexes {};
+    for (auto& [re, value] : Synthetic::makeGrammar(state.range(0)))
+        regexes.push_back(re);
+    return regexes;
+}
+
+static void addConcatOperator(benchmark::State& state)
+{
+    const auto regexes = getRegexes(state);
+    for (auto _ : state) {
+        for (auto re : regexes) {
+            Util::addConcatOperator(re);
+            benchmark::DoNotOptimize(re);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * regexes.size());
+}
+BENCHMARK(addConcatOperator)->Arg(10)->Arg(100)->Arg(1000);
+
+static void getPostfixAndChatSet(benchmark::State& state)
+{
+    auto regexes = getRegexes(state);
+    for (auto& re : regexes)
+        Util::addConcatOperator(re);
+
+    for (auto _ : state) {
+        for (auto re : regexes) {
+            FSA::set_t<char> charset {};
+            Util::getPostfixAndChatSet(re, charset);
+            benchmark::DoNotOptimize(re);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * regexes.size());
+}
+BENCHMARK(getPostfixAndChatSet)->Arg(10)->Arg(100)->Arg(1000);
+
+static void parse(benchmark::State& state)
+{
+    const auto regexes = getRegexes(state);
+    for (auto _ : state) {
+        for (auto re : regexes) {
+            NFA nfa(re);
+            benchmark::DoNotOptimize(nfa);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * regexes.size());
+}
+BENCHMARK(parse)->Arg(10)->Arg(100)->Arg(1000);
+
+static void unionAll(benchmark::State& state)
+{
+    const auto rules = Synthetic::makeGrammar(state.range(0));
+    std::vector<NFA> nfas {};
+    for (auto& [key, value] : rules) {
+        auto re = key;
+        auto info = value.second;
+        nfas.emplace_back(re, info, value.first);
+    }
+
+    for (auto _ : state) {
+        NFA nfa {};
+        for (auto& tmp : nfas)
+            nfa = nfa + tmp;
+        benchmark::DoNotOptimize(nfa);
+    }
+    state.SetItemsProcessed(state.iterations() * nfas.size());
+}
+BENCHMARK(unionAll)->Arg(10)->Arg(100)->Arg(1000);
+
+static void epsilonClosures(benchmark::State& state)
+{
+    const auto nfa = NFA::fromRules(Synthetic::makeGrammar(state.range(0)));
+    for (auto _ : state) {
+        auto copy = nfa;
+        copy.buildClosureCache();
+        benchmark::DoNotOptimize(copy);
+    }
+    state.counters["states"] = nfa.getStateCount();
+}
+BENCHMARK(epsilonClosures)->Arg(10)->Arg(100)->Arg(1000);
+
+// a sample of every rule but the whitespace one
+static std::vector<std::string> getSamples(const Synthetic::rules_t& rules)
+{
+    std::vector<std::string> samples {};
+    std::mt19937 rng { 1 };
+    for (auto& [regex, value] : rules) {
+        if (value.second != "WS")
+            Synthetic::Sampler { regex }.sample(rng, samples.emplace_back());
+    }
+    return samples;
+}
+
+// the first match builds the Glushkov automaton, no DFA is needed
+static void matchStartup(benchmark::State& state)
+{
+    const auto rules = Synthetic::makeGrammar(state.range(0));
+    const auto sample = getSamples(rules).front();
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto copy = NFA::fromRules(rules);
+        state.ResumeTiming();
+
+        benchmark::DoNotOptimize(copy.match(sample));
+    }
+}
+BENCHMARK(matchStartup)->Arg(10)->Arg(100)->Arg(1000);
+
+static void match(benchmark::State& state)
+{
+    const auto rules = Synthetic::makeGrammar(state.range(0));
+    const auto nfa = NFA::fromRules(rules);
+    const auto samples = getSamples(rules);
+    nfa.match("");
+
+    std::size_t bytes = 0;
+    for (const auto& sample : samples)
+        bytes += sample.size();
+    for (auto _ : state) {
+        for (const auto& sample : samples)
+            benchmark::DoNotOptimize(nfa.match(sample));
+    }
+    state.SetItemsProcessed(state.iterations() * samples.size());
+    state.SetBytesProcessed(state.iterations() * bytes);
+}
+BENCHMARK(match)->Arg(10)->Arg(100)->Arg(1000);
+
+BENCHMARK_MAIN();
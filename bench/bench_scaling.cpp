@@ -0,0 +1,97 @@
+#include <DFA.hpp>
+#include <Lexer.hpp>
+#include <Synthetic.hpp>
+#include <benchmark/benchmark.h>
+
+// INFO : how construction and scanning scale with the rule count [range(0)]
+
+constexpr std::size_t TEXT_SIZE = 4 << 20;
+
+static const Synthetic::rules_t& getGrammar(std::size_t rule_count)
+{
+    static FSA::map_t<std::size_t, Synthetic::rules_t> grammars {};
+    auto it = grammars.find(rule_count);
+    if (it == grammars.end())
+        it = grammars.emplace(rule_count, Synthetic::makeGrammar(rule_count)).first;
+    return it->second;
+}
+
+static const DFA& getDFA(std::size_t rule_count)
+{
+    static FSA::map_t<std::size_t, DFA> dfas {};
+    auto it = dfas.find(rule_count);
+    if (it == dfas.end()) {
+        DFA dfa(NFA::fromRules(getGrammar(rule_count)));
+        dfa.minimal();
+        it = dfas.emplace(rule_count, std::move(dfa)).first;
+    }
+    return it->second;
+}
+
+static void buildNFA(benchmark::State& state)
+{
+    const auto& rules = getGrammar(state.range(0));
+    std::size_t state_count = 0;
+    for (auto _ : state) {
+        auto nfa = NFA::fromRules(rules);
+        state_count = nfa.getStateCount();
+        benchmark::DoNotOptimize(nfa);
+    }
+    state.counters["states"] = state_count;
+}
+BENCHMARK(buildNFA)->RangeMultiplier(10)->Range(10, 10000)->Unit(benchmark::kMillisecond);
+
+static void buildDFA(benchmark::State& state)
+{
+    const auto nfa = NFA::fromRules(getGrammar(state.range(0)));
+    std::size_t state_count = 0;
+    for (auto _ : state) {
+        DFA dfa(nfa);
+        state_count = dfa.getStateCount();
+        benchmark::DoNotOptimize(dfa);
+    }
+    state.counters["states"] = state_count;
+}
+BENCHMARK(buildDFA)->RangeMultiplier(10)->Range(10, 10000)->Unit(benchmark::kMillisecond);
+
+static void minimal(benchmark::State& state)
+{
+    const DFA dfa(NFA::fromRules(getGrammar(state.range(0))));
+    std::size_t state_count = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto copy = dfa;
+        state.ResumeTiming();
+
+        copy.minimal();
+        state_count = copy.getStateCount();
+        benchmark::DoNotOptimize(copy);
+    }
+    state.counters["states"] = state_count;
+}
+BENCHMARK(minimal)->RangeMultiplier(10)->Range(10, 10000)->Unit(benchmark::kMillisecond);
+
+/**
+ * @brief Scan a corpus of the grammar, range(1) is the noise ratio in percent
+ * a noisy corpus is scanned in skip mode
+ */
+static void scan(benchmark::State& state)
+{
+    const auto& dfa = getDFA(state.range(0));
+    const auto text = Synthetic::makeText(
+        getGrammar(state.range(0)),
+        { .size = TEXT_SIZE, .noise_ratio = static_cast<double>(state.range(1)) / 100 });
+
+    TokenList tokens {};
+    for (auto _ : state) {
+        Lexer lexer(Buffer { std::string_view { text } }, dfa);
+        lexer.setSkipUnmatched(state.range(1) != 0);
+        lexer.getAllTokens(tokens);
+    }
+    state.SetBytesProcessed(state.iterations() * text.size());
+    state.counters["tokens"] = benchmark::Counter(
+        static_cast<double>(state.iterations() * tokens.size()), benchmark::Counter::kIsRate);
+}
+BENCHMARK(scan)->ArgsProduct({ { 10, 100, 1000, 10000 }, { 0, 50 } });
+
+BENCHMARK_MAIN();
@@ -1,21 +1,61 @@
 #pragma once
 #include <FSA.hpp>
+#include <MappedFile.hpp>
+#include <algorithm>
 #include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unistd.h>
 #include <vector>
 
-#if 1
+/**
+ * @class Buffer
+ * @brief input source for the lexer
+ * the input is either contiguous [a memory mapped file or an in-memory string_view, no copy]
+ * or streamed [an istream or a file descriptor] through a fixed-size window which is refilled on
+ * demand, line and column are computed lazily from the position
+ *
+ */
 class Buffer {
 public:
     using linenr_t = int32_t;
     using column_t = int32_t;
+    using pos_t = std::size_t;
     constexpr static linenr_t INVALID_LINENR = -1;
     constexpr static column_t INVALID_COLUMN = -1;
+    constexpr static pos_t INVALID_POS = -1;
     constexpr static char EOF_CHAR = -1;
+    constexpr static std::size_t DEFAULT_CAPACITY = 64 * 1024;
 
 public:
-    Buffer(std::istream& istream);
-
+    /**
+     * @brief Stream the istream through a window of the given capacity
+     */
+    Buffer(std::istream& istream, std::size_t capacity = DEFAULT_CAPACITY);
+
+    /**
+     * @brief Wrap in-memory data without copying, the caller keeps the data alive
+     */
+    explicit Buffer(std::string_view data) noexcept;
+
+    /**
+     * @brief Memory map the given file
+     * a file which can't be mapped gives an empty buffer
+     */
+    static Buffer fromFile(const std::string& filename) noexcept;
+
+    /**
+     * @brief Stream the file descriptor [pipe, socket ...] through a window of the given capacity
+     * the caller keeps the file descriptor open
+     */
+    static Buffer fromFd(int fd, std::size_t capacity = DEFAULT_CAPACITY);
+
+    // NOTE : copies of a streamed buffer share the stream, only one of them should be read
     ~Buffer() = default;
     Buffer(Buffer&&) = default;
     Buffer(const Buffer&) = default;
@@ -24,48 +64,133 @@ public:
 
 public:
     void printLines() const;
-    char peek() const;
+    char peek();
     char take();
     void next();
     void rollback();
-    void rollback(column_t column);
-    void rollback(linenr_t linenr, column_t column);
 
+    /**
+     * @brief Get the input from the current position to the end of the window without refilling
+     * it may be empty before the end of a stream, peek refills
+     */
+    std::string_view lookahead() const;
+
+    /**
+     * @brief Move forward by count chars of the lookahead
+     */
+    void skip(std::size_t count);
+
+    /**
+     * @brief Go back to the given position
+     * a streamed buffer only keeps the input since the lexeme start
+     */
+    void rollback(pos_t pos);
+
+    bool isContiguous() const;
+
+    /**
+     * @brief Get the whole input of a contiguous buffer [positions are indices into it]
+     */
+    std::string_view view() const;
+    pos_t getPos() const;
     linenr_t getLineNr() const;
     column_t getColumn() const;
     void markLexemeStart();
-    std::string takeLexeme();
+
+    /**
+     * @brief Get the lexeme since markLexemeStart without copying
+     * the view is valid as long as the input for a contiguous buffer, and until the next refill
+     * [the next markLexemeStart then peek past the window] for a streamed buffer
+     */
+    std::string_view takeLexeme();
 
 private:
-    std::vector<std::string> _buffer {};
-    linenr_t _cur_linenr {};
-    column_t _cur_column {};
+    Buffer() = default;
+    bool _refill();
+    void _locate(pos_t pos) const;
 
-    linenr_t _lexeme_start_linenr {};
-    column_t _lexeme_start_column {};
+private:
+    struct Stream
+    {
+        std::vector<char> window;
+        std::function<std::size_t(char*, std::size_t)> read;
+        bool eof {};
+    };
+
+    // owns the mapped file, shared between copies
+    std::shared_ptr<const void> _storage {};
+    std::shared_ptr<Stream> _stream {};
+
+    // INFO : _data is the window of the input starting at the absolute position _base
+    std::string_view _data {};
+    pos_t _base {};
+    pos_t _pos {};
+    pos_t _lexeme_start { INVALID_POS };
+
+    // INFO : lazy line tracking, the line of _line_pos is _line_nr and starts at _line_start
+    // the anchor is the line state at _base [all positions are absolute]
+    mutable pos_t _line_pos {};
+    mutable pos_t _line_start {};
+    mutable linenr_t _line_nr {};
+    pos_t _anchor_line_start {};
+    linenr_t _anchor_line_nr {};
 };
 
-inline Buffer::Buffer(std::istream& istream):
-    _lexeme_start_linenr { INVALID_LINENR },
-    _lexeme_start_column { INVALID_COLUMN }
+inline Buffer::Buffer(std::istream& istream, std::size_t capacity):
+    _stream { std::make_shared<Stream>() }
+{
+    assert(capacity > 0);
+    _stream->window.resize(capacity);
+    _stream->read = [&istream](char* dst, std::size_t size) -> std::size_t {
+        istream.read(dst, static_cast<std::streamsize>(size));
+        return static_cast<std::size_t>(istream.gcount());
+    };
+}
+
+inline Buffer::Buffer(std::string_view data) noexcept:
+    _data { data }
 {
-    for (std::string line; std::getline(istream, line);) {
-        _buffer.push_back(std::move(line));
-    }
+}
+
+inline Buffer Buffer::fromFile(const std::string& filename) noexcept
+{
+    Buffer buffer {};
+    auto file = std::make_shared<MappedFile>(filename);
+    buffer._data = file->view();
+    buffer._storage = std::move(file);
+    return buffer;
+}
+
+inline Buffer Buffer::fromFd(int fd, std::size_t capacity)
+{
+    assert(capacity > 0);
+    Buffer buffer {};
+    buffer._stream = std::make_shared<Stream>();
+    buffer._stream->window.resize(capacity);
+    buffer._stream->read = [fd](char* dst, std::size_t size) -> std::size_t {
+        while (true) {
+            auto bytes_read = ::read(fd, dst, size);
+            if (bytes_read >= 0)
+                return static_cast<std::size_t>(bytes_read);
+            if (errno != EINTR)
+                return 0;
+        }
+    };
+    return buffer;
 }
 
 inline void Buffer::printLines() const
 {
-    for (auto& line : _buffer) {
-        std::cout << line << std::endl;
-    }
+    std::cout << _data;
+    if (!_data.empty() && _data.back() != '\n')
+        std::cout << std::endl;
 }
 
-inline char Buffer::peek() const
+inline char Buffer::peek()
 {
-    if (_cur_linenr == _buffer.size())
+    if (_pos == _data.size() && !_refill())
         return EOF_CHAR;
-    return _buffer[_cur_linenr][_cur_column];
+    return _data[_pos];
 }
 
 inline char Buffer::take()
@@ -77,199 +202,135 @@ inline char Buffer::take()
 
 inline void Buffer::next()
 {
-    assert(_cur_linenr < _buffer.size());
-    assert(_cur_column < _buffer[_cur_linenr].size());
+    if (_pos == _data.size())
+        _refill();
+    assert(_pos < _data.size());
+    ++_pos;
+}
 
-    ++_cur_column;
-    if (_cur_column == _buffer[_cur_linenr].size()) {
-        ++_cur_linenr;
-        _cur_column = 0;
-    }
+inline std::string_view Buffer::lookahead() const
+{
+    return _data.substr(_pos);
 }
 
-inline void Buffer::rollback()
+inline void Buffer::skip(std::size_t count)
 {
-    rollback(_cur_linenr, _cur_column - 1);
+    assert(_pos + count <= _data.size());
+    _pos += count;
 }
 
-inline void Buffer::rollback(column_t column)
+inline void Buffer::rollback()
 {
-    rollback(_cur_linenr, column);
+    assert(_pos > 0);
+    rollback(getPos() - 1);
 }
 
-inline void Buffer::rollback(linenr_t linenr, column_t column)
+inline void Buffer::rollback(pos_t pos)
 {
-    assert(linenr < _buffer.size());
-    assert(column < _buffer[linenr].size());
-    _cur_linenr = linenr;
-    _cur_column = column;
+    assert(pos >= _base);
+    assert(pos - _base <= _data.size());
+    _pos = pos - _base;
 }
 
 inline void Buffer::markLexemeStart()
 {
-    _lexeme_start_linenr = _cur_linenr;
-    _lexeme_start_column = _cur_column;
+    _lexeme_start = _pos;
 }
 
-inline std::string Buffer::takeLexeme()
+inline std::string_view Buffer::takeLexeme()
 {
-    assert(_lexeme_start_linenr != INVALID_LINENR);
-    assert(_lexeme_start_column != INVALID_COLUMN);
+    assert(_lexeme_start != INVALID_POS);
+    assert(_lexeme_start <= _pos);
 
-    std::string lexeme;
-    if (_lexeme_start_linenr == _cur_linenr) {
-        lexeme = _buffer[_lexeme_start_linenr].substr(
-            _lexeme_start_column, _cur_column - _lexeme_start_column);
-    }
-    else {
-        lexeme = _buffer[_lexeme_start_linenr].substr(_lexeme_start_column);
-        for (auto i = _lexeme_start_linenr + 1; i < _cur_linenr; ++i) {
-            lexeme += _buffer[i];
-        }
-        lexeme += _buffer[_cur_linenr].substr(0, _cur_column);
-    }
+    auto lexeme = _data.substr(_lexeme_start, _pos - _lexeme_start);
+    _lexeme_start = INVALID_POS;
+    return lexeme;
+}
 
+inline bool Buffer::isContiguous() const
+{
+    return _stream == nullptr;
+}
 
-    _lexeme_start_linenr = INVALID_LINENR;
-    _lexeme_start_column = INVALID_COLUMN;
-    return lexeme;
+inline std::string_view Buffer::view() const
+{
+    assert(isContiguous());
+    return _data;
+}
+
+inline Buffer::pos_t Buffer::getPos() const
+{
+    return _base + _pos;
 }
 
 inline Buffer::linenr_t Buffer::getLineNr() const
 {
-    return _cur_linenr;
+    _locate(getPos());
+    return _line_nr;
 }
 
 inline Buffer::column_t Buffer::getColumn() const
 {
-    return _cur_column;
+    _locate(getPos());
+    return static_cast<column_t>(getPos() - _line_start);
 }
 
-#else // Version 1
-#include <FSA.hpp>
-#include <Token.hpp>
-#include <cassert>
-#include <istream>
-#include <vector>
+/**
+ * @brief Slide the window: drop the input before the in-progress lexeme and read more
+ * the window only grows when a single lexeme doesn't fit in it
+ *
+ * @return whether new input was read
+ */
+inline bool Buffer::_refill()
+{
+    if (!_stream || _stream->eof)
+        return false;
+
+    auto& window = _stream->window;
+    const auto keep = _lexeme_start == INVALID_POS ? _pos : std::min(_lexeme_start, _pos);
 
-// class Buffer {
-// public:
-//     using line_t = uint32_t;
-//     using column_t = uint32_t;
-
-//     using pos_t = int32_t;
-
-// public:
-//     Buffer() = delete;
-//     Buffer& operator= (Buffer&&) = delete;
-//     Buffer& operator= (const Buffer&) = delete;
-
-//     explicit Buffer(std::istream& istream, std::size_t BUFFER_SIZE = 1024):
-//         _istream(istream),
-//         _buffer(BUFFER_SIZE),
-//         _pos(0),
-//         _lexeme {},
-//         _lexeme_start(-1)
-//     {
-//         _refill();
-//     }
-
-//     ~Buffer() = default;
-//     Buffer(Buffer&&) = default;
-//     Buffer(const Buffer&) = default;
-
-// public:
-//     FSA::char_t peek() const;
-//     FSA::char_t take();
-//     void next();
-//     FSA::char_t get(pos_t pos) const;
-
-//     void markLexemeStart();
-//     Lexeme takeLexeme();
-
-// private:
-//     void _refill();
-
-
-// public:
-//     static constexpr pos_t COLUMN_START = 1;
-//     static constexpr FSA::char_t EOF_CHAR = -1;
-
-// private:
-//     std::istream& _istream;
-//     std::vector<FSA::char_t> _buffer;
-
-
-//     pos_t _pos;
-
-//     pos_t _lexeme_start;
-//     Lexeme _lexeme;
-// };
-
-// inline FSA::char_t Buffer::peek() const
-// {
-//     return _buffer[_pos];
-// }
-
-// inline FSA::char_t Buffer::take()
-// {
-//     auto c = peek();
-//     next();
-//     return c;
-// }
-
-// inline FSA::char_t Buffer::get(pos_t pos) const
-// {
-//     assert(pos >= 0 && pos < _buffer.size());
-//     return _buffer[pos];
-// }
-
-// inline void Buffer::markLexemeStart()
-// {
-//     _lexeme_start = _pos;
-// }
-
-// inline Lexeme Buffer::takeLexeme()
-// {
-//     assert(_lexeme_start != -1);
-
-//     _lexeme.value = std::string(_buffer.begin() + _lexeme_start, _buffer.begin() + _pos);
-//     _lexeme_start = -1;
-//     return _lexeme;
-// }
-
-// inline void Buffer::_refill()
-// {
-//     // check whether there is still lexeme in the buffer
-//     assert(_lexeme_start <= _pos);
-
-//     if (_lexeme_start != -1) {
-//         std::copy(_buffer.begin() + _lexeme_start, _buffer.begin() + _pos, _buffer.begin());
-//         _pos -= _lexeme_start;
-//         _lexeme_start = 0;
-//     }
-//     else {
-//         _pos = 0;
-//     }
-
-//     // read from istream
-//     assert(_buffer.size() > _pos);
-//     auto size = (_buffer.size() - _pos) * sizeof(FSA::char_t);
-//     _istream.read(static_cast<char*>(_buffer.data()) + _pos, size);
-
-//     auto bytes_read = _istream.gcount();
-//     if (bytes_read < size) {
-//         auto new_size = (_pos + bytes_read) / sizeof(FSA::char_t) + 1;
-//         _buffer[new_size - 1] = EOF_CHAR;
-//         _buffer.resize(new_size);
-//     }
-// }
-
-// inline void Buffer::next()
-// {
-//     ++_pos;
-//     if (_pos == _buffer.size()) {
-//         _refill();
-//     }
-// }
-#endif
+    // record the line state at the new window start before dropping the input
+    _locate(_base + keep);
+    _anchor_line_nr = _line_nr;
+    _anchor_line_start = _line_start;
+
+    auto size = _data.size() - keep;
+    std::memmove(window.data(), window.data() + keep, size);
+    _base += keep;
+    _pos -= keep;
+    if (_lexeme_start != INVALID_POS)
+        _lexeme_start -= keep;
+
+    if (size == window.size())
+        window.resize(window.size() * 2);
+
+    auto bytes_read = _stream->read(window.data() + size, window.size() - size);
+    if (bytes_read == 0)
+        _stream->eof = true;
+
+    _data = { window.data(), size + bytes_read };
+    return bytes_read != 0;
+}
+
+// move the line cursor to the given position, only counting the newlines in between
+inline void Buffer::_locate(pos_t pos) const
+{
+    if (pos < _line_pos || _line_pos < _base) {
+        _line_pos = _base;
+        _line_start = _anchor_line_start;
+        _line_nr = _anchor_line_nr;
+    }
+
+    auto cur = _data.data() + (_line_pos - _base);
+    const auto end = _data.data() + (pos - _base);
+    while (cur < end) {
+        auto newline = static_cast<const char*>(std::memchr(cur, '\n', end - cur));
+        if (!newline)
+            break;
+
+        ++_line_nr;
+        cur = newline + 1;
+        _line_start = _base + (cur - _data.data());
+    }
+    _line_pos = pos;
+}
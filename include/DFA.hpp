@@ -1,16 +1,37 @@
 #pragma once
 #include <FSA.hpp>
+#include <MappedDFA.hpp>
 #include <NFA.hpp>
+#include <Profile.hpp>
+#include <Simd.hpp>
+#include <Subset.hpp>
+#include <array>
+#include <atomic>
+#include <barrier>
+#include <cctype>
 #include <fmt/format.h>
 #include <queue>
-#include <range/v3/all.hpp>
 #include <string>
+#include <thread>
+#include <vector>
 
 // (D)eterministic (F)inite (A)utomata
 class DFA: public FSA {
+public:
+    using char_class_t = uint8_t;
+    using state_info_map_t = pmr_map_t<state_t, state_info_t>;
+    using final_state_set_t = pmr_set_t<state_t>;
+    constexpr static size_t ALPHABET_SIZE = 256;
+
 public:
     DFA(const NFA& nfa) noexcept;
 
+    /**
+     * @brief Run the subset construction on thread_count threads
+     * the result is identical to the single threaded one [same state numbering]
+     */
+    DFA(const NFA& nfa, std::size_t thread_count) noexcept;
+
 
     // clang-format off
     // DFA() noexcept  = default;
@@ -26,9 +47,39 @@ public:
 
     std::optional<state_t> getReachedState(state_t state, char_t ch) const noexcept
     {
-        return (_state_transition_map.count({ state, ch }) == 0)
-                 ? std::nullopt
-                 : std::make_optional(_state_transition_map.at({ state, ch }));
+        auto next_state = getNextState(state, ch);
+        return next_state == _dead_state ? std::nullopt : std::make_optional(next_state);
+    }
+
+    /**
+     * @brief Get the next state via the compiled transition table
+     * return the dead state if there is no transition
+     *
+     * @param state current state [dead state is allowed]
+     * @param ch input char
+     */
+    state_t getNextState(state_t state, char_t ch) const noexcept
+    {
+        return _transition_table[state * _class_count + getCharClass(ch)];
+    }
+
+    /**
+     * @brief Get the equivalence class of the given char
+     * chars in the same class have identical transitions in every state
+     */
+    char_class_t getCharClass(char_t ch) const noexcept
+    {
+        return _char_class[static_cast<unsigned char>(ch)];
+    }
+
+    size_t getClassCount() const noexcept
+    {
+        return _class_count;
+    }
+
+    state_t getDeadState() const noexcept
+    {
+        return _dead_state;
     }
 
     void minimal() noexcept;
@@ -38,25 +89,102 @@ public:
         return _start_state;
     }
 
+    size_t getStateCount() const noexcept
+    {
+        return _state_count;
+    }
+
     bool isFinalState(state_t state) const noexcept
     {
-        return _final_state_set.count(state) != 0;
+        return _final_table[state];
+    }
+
+    const state_info_t& getStateInfo(state_t state) const noexcept
+    {
+        assert(_accept_table[state] != INVALID_KIND);
+        return _token_names[_accept_table[state]];
+    }
+
+    /**
+     * @brief Get the token kind accepted by the given state
+     * return INVALID_KIND if the state accepts nothing
+     */
+    kind_t getAcceptKind(state_t state) const noexcept
+    {
+        return _accept_table[state];
+    }
+
+    /**
+     * @brief Get the bytes which keep the DFA in the given state
+     * return nullptr if there are none, or too many ranges of them to scan vectorized
+     */
+    const Simd::RangeSet* getSelfLoop(state_t state) const noexcept
+    {
+        const auto index = _self_loop_index[state];
+        return index == -1 ? nullptr : &_self_loops[index];
+    }
+
+    /**
+     * @brief Get the literal every token starts with [empty if there is none]
+     */
+    const str_t& getLiteralPrefix() const noexcept
+    {
+        return _literal_prefix;
     }
 
-    state_info_t getStateInfo(state_t state) const noexcept
+    /**
+     * @brief Get the bytes no token starts with
+     * return nullptr if there are too many ranges of them to scan vectorized
+     */
+    const Simd::RangeSet* getNoiseSet() const noexcept
     {
-        return _state_info_map.at(state);
+        return _noise_set ? &*_noise_set : nullptr;
+    }
+
+    /**
+     * @brief Get the token type name of the given kind
+     */
+    const state_info_t& getTokenName(kind_t kind) const noexcept
+    {
+        return _token_names[kind];
+    }
+
+    const std::vector<state_info_t>& getTokenNames() const noexcept
+    {
+        return _token_names;
     }
 
     void printStateInfo() const
     {
-        assert(!_state_info_map.empty());
-        for (auto& [state, info] : _state_info_map) {
+        assert(!_tables->state_info_map.empty());
+        for (auto& [state, info] : _tables->state_info_map) {
             fmt::print("state: {}, info: {}\n", state, info);
         }
     }
 
     void saveTo(const str_t& filename) const noexcept;
+
+    /**
+     * @brief Save the compiled tables in the binary format, see BinaryFormat and MappedDFA
+     * a service can swap the grammar by mapping another file, without a rebuild
+     *
+     * @return false if the file can't be written
+     */
+    bool saveBinaryTo(const str_t& filename) const noexcept;
+
+    /**
+     * @brief Generate a standalone lexer header
+     * the header only holds constexpr data and the scanning functions, it needs neither
+     * dynamic initialization nor the NFA/DFA headers
+     *
+     * @param filename the output header
+     * @param format TABLE: flat arrays walked by a loop | DIRECT: goto/switch code per state
+     * @param name the namespace of the generated lexer
+     */
+    void saveLexerTo(
+        const str_t& filename,
+        LexerFmt format = LexerFmt::TABLE,
+        const str_t& name = "generated") const noexcept;
     __attribute__((used)) str_t toDotString() noexcept;
 
 private:
@@ -65,6 +193,13 @@ private:
         return _state_count++;
     }
 
+    void _subsetConstruction(const NFA& nfa) noexcept;
+    void _parallelSubsetConstruction(const NFA& nfa, std::size_t thread_count) noexcept;
+    void _compile() noexcept;
+    void _toLexer(std::ostream& os, LexerFmt format, const str_t& name) const noexcept;
+    str_t _toTableMatch() const noexcept;
+    str_t _toDirectMatch() const noexcept;
+
     void _toMarkdown(std::ostream& os) noexcept;
     void _toDotFile(std::ostream& os) noexcept;
 
@@ -78,40 +213,77 @@ private:
 public:
     struct Builder
     {
-        map_t<state_t, state_info_t> state_info_map;
+        state_info_map_t state_info_map;
         transition_map_t state_transition_map;
-        state_set_t final_state_set;
+        final_state_set_t final_state_set;
         set_t<char_t> charset;
         state_t start_state;
         size_t state_count;
     };
 
     DFA(Builder&& builder) noexcept:
-        _state_info_map { std::move(builder.state_info_map) },
-        _state_transition_map { std::move(builder.state_transition_map) },
-        _final_state_set { std::move(builder.final_state_set) },
         _charset { std::move(builder.charset) },
         _start_state { std::move(builder.start_state) },
         _state_count { std::move(builder.state_count) }
     {
+        _tables->state_info_map.insert(builder.state_info_map.begin(), builder.state_info_map.end());
+        _tables->state_transition_map.insert(builder.state_transition_map.begin(),
+                                             builder.state_transition_map.end());
+        _tables->final_state_set.insert(builder.final_state_set.begin(), builder.final_state_set.end());
+        _compile();
     }
 
-
-private: // INFO :Private members
     /**
-     * @brief final state info
+     * @brief Rebuild the DFA of a mapped binary file [see saveBinaryTo], same states and kinds
+     * the charset is the bytes some state moves on
      */
-    map_t<state_t, state_info_t> _state_info_map {};
+    explicit DFA(const MappedDFA& mapped) noexcept:
+        DFA(_toBuilder(mapped))
+    {
+    }
 
-    /**
-     * @brief state transition map
-     */
-    transition_map_t _state_transition_map {};
+private:
+    static Builder _toBuilder(const MappedDFA& mapped) noexcept;
 
+
+private: // INFO :Private members
     /**
-     * @brief final state set
+     * @struct Tables
+     * @brief the node based containers of the DFA and the arena they are allocated from
      */
-    state_set_t _final_state_set {};
+    struct Tables
+    {
+        Tables() = default;
+
+        Tables(const Tables& other):
+            state_info_map { other.state_info_map, &arena },
+            state_transition_map { other.state_transition_map, &arena },
+            final_state_set { other.final_state_set, &arena }
+        {
+        }
+
+        /**
+         * @brief declared first to outlive the containers
+         */
+        arena_t arena {};
+
+        /**
+         * @brief final state info
+         */
+        state_info_map_t state_info_map { &arena };
+
+        /**
+         * @brief state transition map
+         */
+        transition_map_t state_transition_map { &arena };
+
+        /**
+         * @brief final state set
+         */
+        final_state_set_t final_state_set { &arena };
+    };
+
+    Arena<Tables> _tables {};
 
     /**
      * @brief input charset
@@ -120,62 +292,348 @@ private: // INFO :Private members
 
     state_t _start_state {};
     size_t _state_count {};
+
+    /**
+     * @brief byte -> equivalence class
+     */
+    std::array<char_class_t, ALPHABET_SIZE> _char_class {};
+    size_t _class_count {};
+
+    /**
+     * @brief compiled transition table [(state_count + 1) x class_count, row-major]
+     * the last row is the dead state, every missing transition goes to it
+     */
+    std::vector<state_t> _transition_table {};
+
+    /**
+     * @brief compiled final state flags, indexed by state
+     */
+    std::vector<uint8_t> _final_table {};
+
+    /**
+     * @brief compiled token kind of each state [INVALID_KIND if not accepted]
+     */
+    std::vector<kind_t> _accept_table {};
+
+    /**
+     * @brief kind -> token type name, kinds are numbered in name order
+     */
+    std::vector<state_info_t> _token_names {};
+
+    /**
+     * @brief index into _self_loops of each state [-1 if the state has no self loop]
+     */
+    std::vector<int32_t> _self_loop_index {};
+    std::vector<Simd::RangeSet> _self_loops {};
+
+    /**
+     * @brief where a token may start, to jump over unmatched input
+     */
+    str_t _literal_prefix {};
+    std::optional<Simd::RangeSet> _noise_set {};
+
+    state_t _dead_state { INVALID_STATE };
 };
 
 inline DFA::DFA(const NFA& nfa) noexcept:
+    DFA(nfa, 1)
+{
+}
+
+inline DFA::DFA(const NFA& nfa, std::size_t thread_count) noexcept:
     _charset { nfa.getCharset() }
+{
+    if (thread_count > 1)
+        _parallelSubsetConstruction(nfa, thread_count);
+    else
+        _subsetConstruction(nfa);
+    _compile();
+
+    PROFILE_COUNT("nfa.states", nfa.getStateCount());
+    PROFILE_COUNT("nfa.transitions", nfa.getTransitionCount());
+    PROFILE_COUNT("dfa.states", _state_count);
+    PROFILE_COUNT("dfa.transitions", _tables->state_transition_map.size());
+}
 
+inline void DFA::_subsetConstruction(const NFA& nfa) noexcept
 {
-    auto result = nfa.getReachedStates(nfa.getStartState());
-    assert(result);
-    auto initial_state = *result;
+    PROFILE_SCOPE("dfa.subset");
+    // INFO : every DFA state is a sorted set of NFA states interned by the table,
+    // the ids are handed out in BFS order and equal to the DFA states
+    SubsetConstruction subset { nfa };
+    StateSetTable sets {};
 
-    // TODO :improve memory usage via use pointer to store state_set
-    std::stack<state_set_t> state_stack {};
-    map_t<state_set_t, state_t> states_map {};
+    auto add_state = [this, &sets, &subset](const SubsetConstruction::set_t& set) {
+        auto [id, inserted] = sets.intern(set);
+        if (!inserted)
+            return id;
 
-    auto create_new_state = [this, &states_map, &state_stack, &nfa](const state_set_t& q) {
         auto new_state = _newState();
-        states_map[q] = new_state;
-        state_stack.push(q);
+        assert(new_state == id);
+        if (subset.isFinal(set))
+            _tables->final_state_set.insert(new_state);
+        if (auto info = subset.getStateInfo(set))
+            _tables->state_info_map.emplace(new_state, *info);
+        return id;
+    };
 
-        // check if this state is final state
-        if (nfa.hasFinalState(q))
-            _final_state_set.insert(new_state);
+    SubsetConstruction::set_t initial_set {};
+    subset.getStartSet(initial_set);
+    _start_state = add_state(initial_set);
+
+    for (state_t q = 0; q < sets.size(); ++q) {
+        subset.forEachMove(sets.get(q), [&](char_t ch, const SubsetConstruction::set_t& next_set) {
+            auto next_state = add_state(next_set);
+            _tables->state_transition_map.emplace_hint(_tables->state_transition_map.end(),
+                                               std::make_pair(q, ch),
+                                               next_state);
+        });
+    }
+}
 
-        int priority = -1;
-        for (auto state : q) {
-            auto res = nfa.getStateInfo(state);
-            if (!res)
-                continue;
+/**
+ * @brief level synchronous subset construction
+ * the workers claim chunks of the current BFS level and intern the sets they reach in a sharded
+ * table, the provisional ids are renumbered by a BFS over the explored graph at the end, which
+ * visits the states in the same order as the sequential construction
+ */
+inline void DFA::_parallelSubsetConstruction(const NFA& nfa, std::size_t thread_count) noexcept
+{
+    PROFILE_SCOPE("dfa.subset");
+    using set_t = SubsetConstruction::set_t;
+    constexpr std::size_t CHUNK_SIZE = 16;
+
+    struct Edge
+    {
+        state_t from;
+        char_t ch;
+        state_t to;
+    };
+
+    struct Worker
+    {
+        SubsetConstruction subset;
+        std::vector<Edge> edges {};
+        std::vector<state_t> discovered {};
+        std::vector<state_t> final_states {};
+        std::vector<std::pair<state_t, const state_info_t*>> infos {};
+    };
 
-            if (res->first > priority) {
-                priority = res->first;
-                _state_info_map[new_state] = std::move(res->second);
+    nfa.buildClosureCache();
+    ConcurrentStateSetTable sets {};
+    std::vector<Worker> workers {};
+    workers.reserve(thread_count);
+    for (std::size_t i = 0; i < thread_count; ++i)
+        workers.push_back({ SubsetConstruction { nfa } });
+
+    auto add_state = [&sets](Worker& worker, const set_t& set) {
+        auto [id, inserted] = sets.intern(set);
+        if (inserted) {
+            worker.discovered.push_back(id);
+            if (worker.subset.isFinal(set))
+                worker.final_states.push_back(id);
+            if (auto info = worker.subset.getStateInfo(set))
+                worker.infos.emplace_back(id, info);
+        }
+        return id;
+    };
+
+    set_t initial_set {};
+    workers.front().subset.getStartSet(initial_set);
+    const auto start = add_state(workers.front(), initial_set);
+
+    std::vector<state_t> level {};
+    std::atomic<std::size_t> next_chunk { 0 };
+    bool done = false;
+    auto next_level = [&]() noexcept {
+        level.clear();
+        for (auto& worker : workers) {
+            level.insert(level.end(), worker.discovered.begin(), worker.discovered.end());
+            worker.discovered.clear();
+        }
+        next_chunk = 0;
+        done = level.empty();
+    };
+    next_level();
+
+    std::barrier sync { static_cast<std::ptrdiff_t>(thread_count), next_level };
+    auto explore = [&](Worker& worker) {
+        set_t set {};
+        while (!done) {
+            for (auto begin = next_chunk.fetch_add(CHUNK_SIZE); begin < level.size();
+                 begin = next_chunk.fetch_add(CHUNK_SIZE)) {
+                auto end = std::min(begin + CHUNK_SIZE, level.size());
+                for (auto i = begin; i < end; ++i) {
+                    const auto q = level[i];
+                    sets.get(q, set);
+                    worker.subset.forEachMove(set, [&](char_t ch, const set_t& next_set) {
+                        worker.edges.push_back({ q, ch, add_state(worker, next_set) });
+                    });
+                }
             }
+            sync.arrive_and_wait();
         }
     };
-    create_new_state(initial_state);
 
-    while (!state_stack.empty()) {
-        // INFO :Bug
-        // auto& q = st.top();
-        auto q = state_stack.top();
-        state_stack.pop();
+    {
+        std::vector<std::jthread> threads {};
+        for (std::size_t i = 1; i < thread_count; ++i)
+            threads.emplace_back(explore, std::ref(workers[i]));
+        explore(workers.front());
+    }
 
-        for (auto ch : _charset) {
-            auto q_next_ptr = nfa.getReachedStates(q, ch);
-            if (!q_next_ptr) {
-                continue;
+    // INFO : CSR of the explored edges by provisional id, a state is explored by one worker
+    // in char order, so its edges stay sorted
+    const auto id_bound = sets.getIdBound();
+    std::vector<std::size_t> offsets(id_bound + 1, 0);
+    for (const auto& worker : workers)
+        for (const auto& edge : worker.edges)
+            ++offsets[edge.from + 1];
+    for (std::size_t i = 0; i < id_bound; ++i)
+        offsets[i + 1] += offsets[i];
+    std::vector<std::pair<char_t, state_t>> edges(offsets.back());
+    {
+        auto fill = offsets;
+        for (const auto& worker : workers)
+            for (const auto& edge : worker.edges)
+                edges[fill[edge.from]++] = { edge.ch, edge.to };
+    }
+
+    // renumber in BFS order
+    std::vector<state_t> renumber(id_bound, INVALID_STATE);
+    std::vector<state_t> order { start };
+    renumber[start] = _newState();
+    _start_state = renumber[start];
+    for (std::size_t i = 0; i < order.size(); ++i) {
+        const auto q = order[i];
+        for (auto e = offsets[q]; e < offsets[q + 1]; ++e) {
+            auto [ch, to] = edges[e];
+            if (renumber[to] == INVALID_STATE) {
+                renumber[to] = _newState();
+                order.push_back(to);
             }
+            _tables->state_transition_map.emplace_hint(_tables->state_transition_map.end(),
+                                               std::make_pair(renumber[q], ch),
+                                               renumber[to]);
+        }
+    }
+
+    for (const auto& worker : workers) {
+        for (auto state : worker.final_states)
+            _tables->final_state_set.insert(renumber[state]);
+        for (auto [state, info] : worker.infos)
+            _tables->state_info_map.emplace(renumber[state], *info);
+    }
+}
+
+/**
+ * @brief flatten the transition map into a dense table, so that a transition is a single load
+ * bytes with identical transitions in every state are merged into one column [equivalence class]
+ */
+inline void DFA::_compile() noexcept
+{
+    PROFILE_SCOPE("dfa.compile");
+    _dead_state = _state_count;
+    const auto row_count = _state_count + 1;
+
+    // INFO : the columns are only needed here, they are allocated from a local arena
+    arena_t arena {};
+    using column_t = std::pmr::vector<state_t>;
+
+    // column of every input char: the next state for each state
+    pmr_map_t<char_t, column_t> columns { &arena };
+    for (auto ch : _charset)
+        columns[ch].assign(row_count, _dead_state);
+    for (const auto& [transition, next_state] : _tables->state_transition_map) {
+        auto [state, ch] = transition;
+        columns[ch][state] = next_state;
+    }
 
-            // not found in existed states then create a new state
-            if (states_map.find(*q_next_ptr) == states_map.end())
-                create_new_state(*q_next_ptr);
+    // chars outside the charset share the all-dead column
+    const column_t dead_column(row_count, _dead_state, &arena);
+    pmr_map_t<column_t, char_class_t> classes { &arena };
+    std::vector<const column_t*> representatives {};
 
-            _state_transition_map[{ states_map[q], ch }] = states_map[*q_next_ptr];
+    for (size_t byte = 0; byte < ALPHABET_SIZE; ++byte) {
+        auto it = columns.find(static_cast<char_t>(byte));
+        const auto& column = it == columns.end() ? dead_column : it->second;
+
+        auto [cls, inserted] = classes.try_emplace(column, representatives.size());
+        if (inserted)
+            representatives.push_back(&cls->first);
+        _char_class[byte] = cls->second;
+    }
+    _class_count = representatives.size();
+
+    _transition_table.resize(row_count * _class_count);
+    for (size_t cls = 0; cls < _class_count; ++cls) {
+        const auto& column = *representatives[cls];
+        for (size_t state = 0; state < row_count; ++state)
+            _transition_table[state * _class_count + cls] = column[state];
+    }
+
+    _final_table.assign(row_count, false);
+    for (auto state : _tables->final_state_set)
+        _final_table[state] = true;
+
+    map_t<state_info_t, kind_t> kinds {};
+    for (const auto& [state, info] : _tables->state_info_map)
+        kinds.emplace(info, 0);
+
+    _token_names.clear();
+    for (auto& [info, kind] : kinds) {
+        kind = _token_names.size();
+        _token_names.push_back(info);
+    }
+
+    _accept_table.assign(row_count, INVALID_KIND);
+    for (const auto& [state, info] : _tables->state_info_map)
+        _accept_table[state] = kinds.at(info);
+
+    // the runs of a self looping state [whitespace, identifier chars ...] are skipped vectorized
+    _self_loop_index.assign(row_count, -1);
+    _self_loops.clear();
+    for (state_t state = 0; state < _state_count; ++state) {
+        std::array<bool, ALPHABET_SIZE> loop {};
+        bool has_loop = false;
+        for (size_t byte = 0; byte < ALPHABET_SIZE; ++byte) {
+            loop[byte] = _transition_table[state * _class_count + _char_class[byte]] == state;
+            has_loop |= loop[byte];
+        }
+        if (!has_loop)
+            continue;
+
+        if (auto set = Simd::RangeSet::fromTable(loop)) {
+            _self_loop_index[state] = _self_loops.size();
+            _self_loops.push_back(*set);
         }
     }
+
+    std::array<bool, ALPHABET_SIZE> noise {};
+    for (size_t byte = 0; byte < ALPHABET_SIZE; ++byte)
+        noise[byte] = _transition_table[_start_state * _class_count + _char_class[byte]] == _dead_state;
+    _noise_set = Simd::RangeSet::fromTable(noise);
+
+    // follow the states with a single way out until a token may end
+    _literal_prefix.clear();
+    for (auto state = _start_state; !_final_table[state] && _literal_prefix.size() < _state_count;) {
+        state_t next_state = _dead_state;
+        size_t way_count = 0;
+        char_t ch {};
+        for (size_t byte = 0; byte < ALPHABET_SIZE && way_count < 2; ++byte) {
+            auto reached = _transition_table[state * _class_count + _char_class[byte]];
+            if (reached != _dead_state) {
+                next_state = reached;
+                ch = static_cast<char_t>(byte);
+                ++way_count;
+            }
+        }
+        if (way_count != 1)
+            break;
+
+        _literal_prefix += ch;
+        state = next_state;
+    }
 }
 
 inline void DFA::_toMarkdown(const str_t& filename, const std::ios_base::openmode openmode) noexcept
@@ -215,7 +673,7 @@ inline DFA::str_t DFA::toDotString() noexcept
     using namespace fmt::literals;
     auto get_final_state_set = [this]() {
         DFA::str_t str;
-        for (const auto state : _final_state_set) {
+        for (const auto state : _tables->final_state_set) {
             str += fmt::format("{} [shape=doublecircle, color=purple];\n", state);
         }
         return str;
@@ -240,118 +698,243 @@ inline DFA::str_t DFA::toDotString() noexcept
         "start"_a = _start_state,
         "graph_style"_a = graph_style,
         "_final_state_set"_a = get_final_state_set(),
-        "transition_map"_a = _state_transition_map);
+        "transition_map"_a = _tables->state_transition_map);
 }
 
+/**
+ * @brief Hopcroft's algorithm for DFA minimization, O(n * k * log n) on the compiled table
+ * the initial partition groups the states by their accepted token kind, so states accepting
+ * different tokens are never merged. States are renumbered in BFS order from the start state,
+ * unreachable states and states equivalent to the dead state are dropped
+ */
 inline void DFA::minimal() noexcept
 {
-    using namespace ranges;
-#if 1
-    // INFO :Hopcroft's Algorith for DFA minimization
+    PROFILE_SCOPE("dfa.minimal");
+    const auto row_count = _state_count + 1;
+    const auto class_count = _class_count;
+
+    // INFO : inverse transitions [class x target -> sources], CSR layout
+    std::vector<size_t> inverse_offset(class_count * row_count + 1, 0);
+    std::vector<state_t> inverse_sources(row_count * class_count);
+    for (size_t state = 0; state < row_count; ++state)
+        for (size_t cls = 0; cls < class_count; ++cls)
+            ++inverse_offset[cls * row_count + _transition_table[state * class_count + cls] + 1];
+    for (size_t i = 1; i < inverse_offset.size(); ++i)
+        inverse_offset[i] += inverse_offset[i - 1];
+    {
+        auto fill = inverse_offset;
+        for (size_t state = 0; state < row_count; ++state)
+            for (size_t cls = 0; cls < class_count; ++cls)
+                inverse_sources[fill[cls * row_count + _transition_table[state * class_count + cls]]++] =
+                    state;
+    }
 
-    // divide into two groups: final state and non-final state
-    // clang-format off
-    set_t<state_set_t> groups { 
-        views::ints(state_t{0}, _state_count) 
-        | views::filter([&](state_t state) { return _final_state_set.count(state) == 0; })
-        | to<state_set_t>(), 
+    // INFO : refinable partition, block b owns elements[first[b], end[b]), and the marked ones
+    // are moved to the front [first[b], mid[b])
+    std::vector<state_t> elements(row_count), location(row_count), block_of(row_count);
+    std::vector<size_t> first {}, mid {}, end {};
+
+    { // initial partition: (final, accepted kind)
+        arena_t arena {};
+        pmr_map_t<std::pair<bool, kind_t>, std::pmr::vector<state_t>> groups { &arena };
+        for (size_t state = 0; state < row_count; ++state)
+            groups[{ _final_table[state] != 0, _accept_table[state] }].push_back(state);
+
+        size_t index = 0;
+        for (const auto& [key, group] : groups) {
+            first.push_back(index);
+            for (auto state : group) {
+                elements[index] = state;
+                location[state] = index++;
+                block_of[state] = first.size() - 1;
+            }
+            mid.push_back(first.back());
+            end.push_back(index);
+        }
+    }
 
-        _final_state_set
+    std::vector<state_t> worklist {};
+    std::vector<uint8_t> in_worklist(first.size(), true);
+    for (size_t block = 0; block < first.size(); ++block)
+        worklist.push_back(block);
+
+    std::vector<state_t> touched {}, splitter {};
+    auto mark = [&](state_t state) {
+        auto block = block_of[state];
+        auto i = location[state];
+        if (i < mid[block])
+            return;
+
+        auto j = mid[block]++;
+        std::swap(elements[i], elements[j]);
+        location[elements[i]] = i;
+        location[elements[j]] = j;
+        if (j == first[block])
+            touched.push_back(block);
     };
-    // clang-format on
-    std::stack<state_set_t> st {};
-    {
-        auto cur = groups.begin();
-        st.emplace(*cur++);
-        st.emplace(*cur);
+
+    while (!worklist.empty()) {
+        auto splitter_block = worklist.back();
+        worklist.pop_back();
+        in_worklist[splitter_block] = false;
+        // the splitter itself may be split below, so work on a copy
+        splitter.assign(
+            elements.begin() + first[splitter_block], elements.begin() + end[splitter_block]);
+
+        for (size_t cls = 0; cls < class_count; ++cls) {
+            for (auto target : splitter) {
+                auto offset = cls * row_count + target;
+                for (auto i = inverse_offset[offset]; i < inverse_offset[offset + 1]; ++i)
+                    mark(inverse_sources[i]);
+            }
+
+            for (auto block : touched) {
+                if (mid[block] == end[block]) {
+                    mid[block] = first[block];
+                    continue;
+                }
+
+                // the marked part becomes a new block
+                auto new_block = static_cast<state_t>(first.size());
+                first.push_back(first[block]);
+                end.push_back(mid[block]);
+                mid.push_back(first[block]);
+                for (auto i = first[block]; i < mid[block]; ++i)
+                    block_of[elements[i]] = new_block;
+                first[block] = mid[block];
+
+                in_worklist.push_back(false);
+                if (in_worklist[block]) {
+                    worklist.push_back(new_block);
+                    in_worklist[new_block] = true;
+                }
+                else {
+                    auto smaller = end[new_block] - first[new_block] < end[block] - first[block]
+                                     ? new_block
+                                     : block;
+                    worklist.push_back(smaller);
+                    in_worklist[smaller] = true;
+                }
+            }
+            touched.clear();
+        }
     }
 
-    auto split = [this](state_set_t& set) -> std::optional<std::pair<state_set_t, state_set_t>> {
-        for (auto ch : _charset) {
-            auto cur = set.begin();
-            std::vector<state_set_t> split_groups { 2 };
+    // INFO : renumber the blocks in BFS order from the start state, skipping the dead block
+    const auto dead_block = block_of[_dead_state];
+    std::vector<state_t> new_state(first.size(), INVALID_STATE);
+    std::vector<state_t> representatives { _start_state };
+    new_state[block_of[_start_state]] = 0;
+    for (size_t i = 0; i < representatives.size(); ++i) {
+        for (size_t cls = 0; cls < class_count; ++cls) {
+            auto target = _transition_table[representatives[i] * class_count + cls];
+            auto block = block_of[target];
+            if (block == dead_block || new_state[block] != INVALID_STATE)
+                continue;
 
-            split_groups[0].emplace(*cur);
-            auto should_be = _state_transition_map.count({ *cur++, ch });
-            // TODO :
-            for (; cur != set.end(); cur++) {
-                decltype(split_groups.size()) index =
-                    should_be != _state_transition_map.count({ *cur, ch });
+            new_state[block] = representatives.size();
+            representatives.push_back(target);
+        }
+    }
 
-                split_groups[index].emplace(*cur);
+    { // INFO : Update, the new tables get a new arena and the old one is released at once
+        auto tables = std::make_unique<Tables>();
+        auto& state_transition_map = tables->state_transition_map;
+        auto& final_state_set = tables->final_state_set;
+        auto& state_info_map = tables->state_info_map;
+
+        for (state_t state = 0; state < representatives.size(); ++state) {
+            auto representative = representatives[state];
+            for (auto ch : _charset) {
+                auto target = getNextState(representative, ch);
+                if (block_of[target] != dead_block)
+                    state_transition_map[{ state, ch }] = new_state[block_of[target]];
             }
 
-            if (split_groups[1].size())
-                return std::make_pair(split_groups[0], split_groups[1]);
+            if (_final_table[representative])
+                final_state_set.insert(state);
+            if (_accept_table[representative] != INVALID_KIND)
+                state_info_map[state] = _token_names[_accept_table[representative]];
         }
 
-        return std::nullopt;
-    };
-
-    // split until no more split
-    while (st.size()) {
-        auto cur = st.top();
-        st.pop();
+        _tables.reset(std::move(tables));
+        _start_state = 0;
+        _state_count = representatives.size();
+    }
 
-        if (cur.size() <= 1)
-            continue;
+    _compile();
+    PROFILE_COUNT("dfa.minimal_states", _state_count);
+    PROFILE_COUNT("dfa.minimal_transitions", _tables->state_transition_map.size());
+}
 
-        auto res = split(cur);
-        if (!res)
-            continue;
+inline DFA::Builder DFA::_toBuilder(const MappedDFA& mapped) noexcept
+{
+    assert(mapped.isValid());
+    Builder builder {};
+    builder.start_state = mapped.getStartState();
+    builder.state_count = mapped.getStateCount();
+    for (state_t state = 0; state < builder.state_count; ++state) {
+        if (const auto kind = mapped.getAcceptKind(state); kind != INVALID_KIND) {
+            builder.final_state_set.insert(state);
+            builder.state_info_map.emplace(state, state_info_t { mapped.getTokenName(kind) });
+        }
+        for (size_t byte = 0; byte < ALPHABET_SIZE; ++byte) {
+            const auto ch = static_cast<char_t>(byte);
+            const auto next_state = mapped.getNextState(state, ch);
+            if (next_state == mapped.getDeadState())
+                continue;
+            builder.state_transition_map.emplace(transition_t { state, ch }, next_state);
+            builder.charset.insert(ch);
+        }
+    }
+    return builder;
+}
 
-        groups.erase(cur);
-        groups.emplace(res->first);
-        groups.emplace(res->second);
+inline bool DFA::saveBinaryTo(const str_t& filename) const noexcept
+{
+    using namespace BinaryFormat;
+    const auto row_count = static_cast<uint32_t>(_state_count + 1);
 
-        st.emplace(res->first);
-        st.emplace(res->second);
+    str_t payload {};
+    auto append = [&payload](const auto* data, std::size_t count) {
+        payload.append(reinterpret_cast<const char*>(data), count * sizeof(*data));
+    };
+    append(_char_class.data(), _char_class.size());
+    append(_transition_table.data(), _transition_table.size());
+    append(_accept_table.data(), _accept_table.size());
+
+    std::vector<uint32_t> token_offsets { 0 };
+    str_t string_pool {};
+    for (const auto& name : _token_names) {
+        string_pool += name;
+        token_offsets.push_back(string_pool.size());
     }
+    append(token_offsets.data(), token_offsets.size());
+    payload += string_pool;
 
-    // convert original state to new state
-    map_t<state_t, state_t> new_state_map {};
-    decltype(_state_transition_map) new_state_transition_map {};
+    // clang-format off
+    const header_t header {
+        .magic = MAGIC,
+        .version = VERSION,
+        .byte_order = BYTE_ORDER_MARK,
+        .row_count = row_count,
+        .class_count = _class_count,
+        .start_state = _start_state,
+        .dead_state = _dead_state,
+        .token_count = static_cast<uint32_t>(_token_names.size()),
+        .string_pool_size = static_cast<uint32_t>(string_pool.size()),
+        .payload_size = payload.size(),
+        .checksum = checksum(payload),
+    };
+    // clang-format on
+    assert(getPayloadSize(header) == payload.size());
 
-    for (auto& group : groups) {
-        auto new_state = _newState();
-        for (auto state : group)
-            new_state_map.emplace(state, new_state);
-    }
-
-    { // INFO : Update
-        // update start state transition
-        _start_state = new_state_map.at(_start_state);
-
-        // update final state set
-        // clang-format off
-        _final_state_set = _final_state_set
-            | views::transform([&new_state_map](state_t state) { return new_state_map[state]; })
-            | to<decltype(_final_state_set)>();
-        // clang-format on
-
-        // update state transition map
-        // clang-format off
-        _state_transition_map = _state_transition_map
-            | views::transform([&new_state_map](auto&& pair) {
-                return std::make_pair(
-                      std::make_pair(new_state_map[pair.first.first], pair.first.second),
-                      new_state_map[pair.second]
-                );
-              })
-            | to<decltype(_state_transition_map)>();
-        // clang-format on
-
-        // update state info
-        // clang-format off
-        _state_info_map = _state_info_map
-            | views::transform([&new_state_map](auto&& pair) {
-                return std::make_pair(new_state_map[pair.first], pair.second);
-            })
-            | to<decltype(_state_info_map)>();
-        // clang-format on
-    }
-#endif
-    // INFO :Brzozowski's Algorithm for DFA minimization
+    std::ofstream fout { filename, std::ios_base::out | std::ios_base::binary };
+    if (!fout.is_open())
+        return false;
+    fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    fout.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+    return fout.good();
 }
 
 inline void DFA::saveTo(const str_t& filename) const noexcept
@@ -363,7 +946,7 @@ inline void DFA::saveTo(const str_t& filename) const noexcept
 
     auto saveStateInfoMap = [this]() {
         str_t str;
-        for (const auto& [state, info] : _state_info_map) {
+        for (const auto& [state, info] : _tables->state_info_map) {
             str += fmt::format("{{ {}, {} }},\n", state, info);
         }
         return str;
@@ -371,7 +954,7 @@ inline void DFA::saveTo(const str_t& filename) const noexcept
 
     auto saveStateTransitionMap = [this]() {
         str_t str;
-        for (const auto& [pair, state] : _state_transition_map) {
+        for (const auto& [pair, state] : _tables->state_transition_map) {
             // {{from, ch} , to}
             str += fmt::format("{{ {{ {}, '{}' }}, {}}},\n", pair.first, pair.second, state);
         }
@@ -380,7 +963,7 @@ inline void DFA::saveTo(const str_t& filename) const noexcept
 
     auto saveFinalStateSet = [this]() {
         str_t str;
-        for (const auto& state : _final_state_set) {
+        for (const auto& state : _tables->final_state_set) {
             str += fmt::format("{},\n", state);
         }
         return str;
@@ -421,3 +1004,245 @@ inline void DFA::saveTo(const str_t& filename) const noexcept
     );
     // clang-format on
 }
+
+inline void DFA::saveLexerTo(
+    const str_t& filename, LexerFmt format, const str_t& name) const noexcept
+{
+    std::ofstream fout { filename, std::ios_base::out | std::ios_base::binary };
+    assert(fout.is_open());
+    _toLexer(fout, format, name);
+}
+
+inline void DFA::_toLexer(std::ostream& os, LexerFmt format, const str_t& name) const noexcept
+{
+    using namespace fmt::literals;
+
+    // the dead state is the largest state, so the smallest type is picked from it
+    auto stateType = [this]() {
+        return _dead_state <= UINT8_MAX  ? "std::uint8_t"
+             : _dead_state <= UINT16_MAX ? "std::uint16_t"
+                                         : "std::uint32_t";
+    };
+
+    auto saveTokenNames = [this]() {
+        str_t str;
+        for (const auto& name : _token_names)
+            str += fmt::format("\n    \"{}\",", Util::escapeString(name));
+        return str;
+    };
+
+    // clang-format off
+    os << fmt::format(
+        "// Generated by lexer_generator, do not edit\n"
+        "#pragma once\n"
+        "#include <cstddef>\n"
+        "#include <cstdint>\n"
+        "#include <string_view>\n"
+        "\n"
+        "namespace {name} {{\n"
+        "\n"
+        "using state_t = {state_type};\n"
+        "using kind_t = std::uint32_t;\n"
+        "\n"
+        "inline constexpr kind_t INVALID_KIND = static_cast<kind_t>(-1);\n"
+        "inline constexpr state_t START_STATE = {start_state};\n"
+        "inline constexpr state_t DEAD_STATE = {dead_state};\n"
+        "\n"
+        "// kind -> token type name\n"
+        "inline constexpr std::string_view token_names[{kind_count}] = {{{token_names}\n}};\n"
+        "\n"
+        "struct Match\n"
+        "{{\n"
+        "    kind_t kind;\n"
+        "    std::size_t length;\n"
+        "}};\n"
+        "\n"
+        "struct Token\n"
+        "{{\n"
+        "    kind_t kind;\n"
+        "    std::string_view value;\n"
+        "    std::size_t offset;\n"
+        "}};\n"
+        "\n"
+        "{match}"
+        "\n"
+        "// call on_token(const Token&) for every token, return the offset where lexing stopped\n"
+        "// [input.size() unless an unexpected character is met]\n"
+        "template <typename Callback>\n"
+        "inline std::size_t tokenize(std::string_view input, Callback&& on_token)\n"
+        "{{\n"
+        "    const auto begin = input.data(), end = begin + input.size();\n"
+        "    auto cur = begin;\n"
+        "    while (cur != end) {{\n"
+        "        auto [kind, length] = match(cur, end);\n"
+        "        if (kind == INVALID_KIND)\n"
+        "            break;\n"
+        "        on_token(Token {{ kind, {{ cur, length }}, static_cast<std::size_t>(cur - begin) }});\n"
+        "        cur += length;\n"
+        "    }}\n"
+        "    return cur - begin;\n"
+        "}}\n"
+        "\n"
+        "}} // namespace {name}\n",
+        "name"_a = name,
+        "state_type"_a = stateType(),
+        "start_state"_a = _start_state,
+        "dead_state"_a = _dead_state,
+        "kind_count"_a = std::max<std::size_t>(_token_names.size(), 1),
+        "token_names"_a = saveTokenNames(),
+        "match"_a = format == LexerFmt::DIRECT ? _toDirectMatch() : _toTableMatch()
+    );
+    // clang-format on
+}
+
+inline DFA::str_t DFA::_toTableMatch() const noexcept
+{
+    using namespace fmt::literals;
+    constexpr size_t numbers_per_line = 16;
+
+    auto joinNumbers = [](auto&& numbers, size_t per_line) {
+        str_t str;
+        size_t count = 0;
+        for (auto number : numbers) {
+            str += count % per_line == 0 ? "\n    " : " ";
+            str += fmt::format("{},", number);
+            ++count;
+        }
+        return str;
+    };
+
+    auto saveCharClass = [&]() {
+        std::vector<unsigned> char_class(_char_class.begin(), _char_class.end());
+        return joinNumbers(char_class, numbers_per_line);
+    };
+
+    auto saveAcceptTable = [&]() {
+        str_t str;
+        size_t count = 0;
+        for (auto kind : _accept_table) {
+            str += count++ % numbers_per_line == 0 ? "\n    " : " ";
+            str += kind == INVALID_KIND ? "INVALID_KIND," : fmt::format("{},", kind);
+        }
+        return str;
+    };
+
+    // clang-format off
+    return fmt::format(
+        "inline constexpr std::size_t CLASS_COUNT = {class_count};\n"
+        "\n"
+        "// byte -> equivalence class\n"
+        "inline constexpr std::uint8_t char_class[256] = {{{char_class}\n}};\n"
+        "\n"
+        "// [state x class] -> next state, the last row is the dead state\n"
+        "inline constexpr state_t transition_table[{table_size}] = {{{transition_table}\n}};\n"
+        "\n"
+        "// state -> accepted token kind\n"
+        "inline constexpr kind_t accept_table[{row_count}] = {{{accept_table}\n}};\n"
+        "\n"
+        "// longest match at the start of [begin, end), kind is INVALID_KIND if nothing matches\n"
+        "inline constexpr Match match(const char* begin, const char* end) noexcept\n"
+        "{{\n"
+        "    Match result {{ INVALID_KIND, 0 }};\n"
+        "    state_t state = START_STATE;\n"
+        "    for (auto cur = begin; cur != end; ++cur) {{\n"
+        "        state = transition_table[state * CLASS_COUNT + char_class[static_cast<unsigned char>(*cur)]];\n"
+        "        if (state == DEAD_STATE)\n"
+        "            break;\n"
+        "        if (accept_table[state] != INVALID_KIND)\n"
+        "            result = {{ accept_table[state], static_cast<std::size_t>(cur - begin + 1) }};\n"
+        "    }}\n"
+        "    return result;\n"
+        "}}\n",
+        "class_count"_a = _class_count,
+        "char_class"_a = saveCharClass(),
+        "table_size"_a = _transition_table.size(),
+        "transition_table"_a = joinNumbers(_transition_table, _class_count),
+        "row_count"_a = _accept_table.size(),
+        "accept_table"_a = saveAcceptTable()
+    );
+    // clang-format on
+}
+
+/**
+ * @brief every reachable state becomes a labeled block: record the accepted kind on entry, then
+ * switch on the next byte and jump to the next state [re2c style]
+ */
+inline DFA::str_t DFA::_toDirectMatch() const noexcept
+{
+    // only emit the states reachable from the start state
+    // the label of a state is only emitted when some transition jumps to it
+    std::vector<state_t> states { _start_state };
+    std::vector<uint8_t> visited(_dead_state + 1, false);
+    std::vector<uint8_t> entered(_dead_state + 1, false);
+    visited[_start_state] = visited[_dead_state] = true;
+    for (size_t i = 0; i < states.size(); ++i) {
+        for (size_t cls = 0; cls < _class_count; ++cls) {
+            auto next_state = _transition_table[states[i] * _class_count + cls];
+            entered[next_state] = true;
+            if (!visited[next_state]) {
+                visited[next_state] = true;
+                states.push_back(next_state);
+            }
+        }
+    }
+
+    auto caseLabel = [](size_t byte) {
+        return std::isalnum(static_cast<int>(byte)) ? fmt::format("'{}'", static_cast<char>(byte))
+                                                    : fmt::format("{}", byte);
+    };
+
+    str_t code {};
+    for (auto state : states) {
+        if (entered[state]) {
+            code += fmt::format("state_{}:\n", state);
+            if (_accept_table[state] != INVALID_KIND) {
+                code += fmt::format(
+                    "    result = {{ {}, static_cast<std::size_t>(cur - begin) }};\n",
+                    _accept_table[state]);
+            }
+        }
+        // the start state accepts nothing when entered at the beginning
+        if (state == _start_state)
+            code += fmt::format("state_{}_scan:\n", state);
+
+        // group the bytes by their next state
+        map_t<state_t, std::vector<size_t>> targets {};
+        for (size_t byte = 0; byte < ALPHABET_SIZE; ++byte) {
+            auto next_state = _transition_table[state * _class_count + _char_class[byte]];
+            if (next_state != _dead_state)
+                targets[next_state].push_back(byte);
+        }
+        if (targets.empty()) {
+            code += "    return result;\n";
+            continue;
+        }
+
+        code += "    if (cur == end)\n"
+                "        return result;\n"
+                "    switch (static_cast<unsigned char>(*cur++)) {\n";
+        for (const auto& [next_state, bytes] : targets) {
+            for (auto byte : bytes)
+                code += fmt::format("        case {}:\n", caseLabel(byte));
+            code += fmt::format("            goto state_{};\n", next_state);
+        }
+        code += "        default:\n"
+                "            return result;\n"
+                "    }\n";
+    }
+
+    // clang-format off
+    return fmt::format(
+        "// longest match at the start of [begin, end), kind is INVALID_KIND if nothing matches\n"
+        "inline Match match(const char* begin, const char* end) noexcept\n"
+        "{{\n"
+        "    Match result {{ INVALID_KIND, 0 }};\n"
+        "    auto cur = begin;\n"
+        "    goto state_{start_state}_scan;\n"
+        "\n"
+        "{code}"
+        "}}\n",
+        fmt::arg("start_state", _start_state),
+        fmt::arg("code", code)
+    );
+    // clang-format on
+}
@@ -3,6 +3,8 @@
 #include <concepts>
 #include <fmt/core.h>
 #include <map>
+#include <memory>
+#include <memory_resource>
 #include <set>
 
 /*
@@ -28,15 +30,25 @@ public:
     template <typename value>
     using set_t = std::set<value>;
 
+    // INFO : node based containers allocated from a memory resource, see Arena
+    template <typename key, typename value>
+    using pmr_map_t = std::pmr::map<key, value>;
+
+    template <typename value>
+    using pmr_set_t = std::pmr::set<value>;
+
+    using arena_t = std::pmr::monotonic_buffer_resource;
+
     using char_t = char;
     using state_t = uint32_t;
     using size_t = uint32_t;
 
     using transition_t = std::pair<state_t, char_t>;
-    using transition_map_t = map_t<transition_t, state_t>;
+    using transition_map_t = pmr_map_t<transition_t, state_t>;
     using state_set_t = set_t<state_t>;
     using str_t = std::string;
     using state_info_t = str_t;
+    using kind_t = uint32_t;
 
 
     enum class DiagramFmt {
@@ -45,7 +57,70 @@ public:
         IMAGE,
     };
 
+    // generated lexer backend
+    enum class LexerFmt {
+        TABLE,  // flat arrays walked by a loop
+        DIRECT, // every state is a labeled block switching on the input byte
+    };
+
+    /**
+     * @class Arena
+     * @brief Owner of a heap allocated tables_t, which holds a monotonic arena and the containers
+     * allocated from it, so the arena always follows its containers:
+     * a move hands the tables over, a copy builds them again on a new arena, and an assignment
+     * releases the old tables together with their arena in one shot
+     * NOTE : the containers are only filled once, a rebuild makes new tables [see reset]
+     * a moved-from automaton can only be destroyed or assigned to
+     *
+     */
+    template <typename tables_t>
+    class Arena {
+    public:
+        Arena():
+            _tables { std::make_unique<tables_t>() }
+        {
+        }
+
+        Arena(Arena&&) noexcept = default;
+
+        Arena(const Arena& other):
+            _tables { other._tables ? std::make_unique<tables_t>(*other._tables) : nullptr }
+        {
+        }
+
+        Arena& operator= (Arena&&) noexcept = default;
+
+        Arena& operator= (const Arena& other)
+        {
+            if (this != &other)
+                *this = Arena { other };
+            return *this;
+        }
+
+        tables_t* operator->() const noexcept
+        {
+            return _tables.get();
+        }
+
+        tables_t& operator* () const noexcept
+        {
+            return *_tables;
+        }
+
+        /**
+         * @brief Replace the tables, the old ones are released with their arena
+         */
+        void reset(std::unique_ptr<tables_t> tables) noexcept
+        {
+            _tables = std::move(tables);
+        }
+
+    private:
+        std::unique_ptr<tables_t> _tables;
+    };
+
     constexpr static state_t INVALID_STATE = -1;
+    constexpr static kind_t INVALID_KIND = -1;
     constexpr static auto graph_style = "rankdir=LR;\n"
                                         "graph [bgcolor = transparent];\n"
                                         "node [color = blue, fontcolor = white]\n"
@@ -0,0 +1,292 @@
+#pragma once
+#include <FSA.hpp>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/**
+ * @class Glushkov
+ * @brief Epsilon free [Glushkov] automaton of a postfix regex, simulated with bitmasks
+ * every char operand of the regex is a position [1..m], position 0 is the start, and a
+ * position is only entered by its own char, so one step over the active positions is
+ *     next = (union of follow[p] for every active p) & mask[ch]
+ * the union is word parallel [Navarro & Raffinot]: it is precomputed for every value of every
+ * 8 bit chunk of the state, so a step is one table row per non-zero byte of the state and the
+ * mask, however many positions of the byte are active
+ * the sets take m / 64 + 1 words, the tables 16 KiB x words², past MAX_TABLE_WORDS the union
+ * falls back to one follow row per active position
+ *
+ */
+class Glushkov {
+public:
+    using word_t = uint64_t;
+    constexpr static std::size_t WORD_BITS = 64;
+    constexpr static std::size_t ALPHABET_SIZE = 256;
+    constexpr static std::size_t CHUNK_BITS = 8;
+    constexpr static std::size_t CHUNKS_PER_WORD = WORD_BITS / CHUNK_BITS;
+    constexpr static word_t CHUNK_MASK = (word_t { 1 } << CHUNK_BITS) - 1;
+    // INFO : 511 positions, 1 MiB of tables
+    constexpr static std::size_t MAX_TABLE_WORDS = 8;
+
+public:
+    /**
+     * @param postfix see Util::getPostfixAndChatSet, the operators are | ^ * + ?
+     */
+    explicit Glushkov(std::string_view postfix);
+
+public:
+    /**
+     * @brief Whether the whole string is in the language
+     */
+    bool match(std::string_view str) const;
+
+    std::size_t getPositionCount() const noexcept
+    {
+        return _position_count;
+    }
+
+private:
+    // INFO : first, last and nullable of a subexpression
+    struct Fragment
+    {
+        std::vector<word_t> first;
+        std::vector<word_t> last;
+        bool nullable;
+    };
+
+    word_t* _row(std::vector<word_t>& sets, std::size_t index) noexcept
+    {
+        return sets.data() + index * _word_count;
+    }
+
+    const word_t* _row(const std::vector<word_t>& sets, std::size_t index) const noexcept
+    {
+        return sets.data() + index * _word_count;
+    }
+
+    // follow[p] |= set for every position p of positions
+    void _addFollow(const std::vector<word_t>& positions, const std::vector<word_t>& set) noexcept;
+
+    // the union tables of every chunk of the state, from the follow sets
+    void _buildFollowTable();
+
+    // next = union of follow[p] for every position p of state
+    void _followUnion(const word_t* state, word_t* next) const noexcept;
+
+    // the union of the follow sets of the lowest non-zero chunk of the w-th word of a state
+    // a single position reads its own follow row, which is smaller and more likely cached
+    const word_t* _chunkFollow(std::size_t w, word_t word) const noexcept
+    {
+        const auto shift = __builtin_ctzll(word) & ~(CHUNK_BITS - 1);
+        const auto value = (word >> shift) & CHUNK_MASK;
+        if (!(value & (value - 1)))
+            return _row(_follow, w * WORD_BITS + shift + __builtin_ctzll(value));
+        return _row(_follow_table, (((w * WORD_BITS + shift) / CHUNK_BITS) << CHUNK_BITS) + value);
+    }
+
+    // the word without its lowest non-zero chunk
+    static word_t _nextChunk(word_t word) noexcept
+    {
+        return word & ~(CHUNK_MASK << (__builtin_ctzll(word) & ~(CHUNK_BITS - 1)));
+    }
+
+    template <typename Callback>
+    static void _forEachBit(const word_t* set, std::size_t word_count, Callback&& callback)
+    {
+        for (std::size_t w = 0; w < word_count; ++w) {
+            for (auto word = set[w]; word; word &= word - 1)
+                callback(w * WORD_BITS + __builtin_ctzll(word));
+        }
+    }
+
+private:
+    std::size_t _position_count {};
+    std::size_t _word_count {};
+
+    // INFO : (positions + 1) x word_count, the row of the start position is the first set
+    std::vector<word_t> _follow {};
+    // INFO : (word_count * CHUNKS_PER_WORD) x 256 x word_count, row (chunk, byte) is the union of
+    // the follow sets of the positions of byte at chunk [empty past MAX_TABLE_WORDS]
+    std::vector<word_t> _follow_table {};
+    // INFO : ALPHABET_SIZE x word_count, the positions of each byte
+    std::vector<word_t> _char_mask {};
+    // INFO : the last positions, and the start position if the regex is nullable
+    std::vector<word_t> _final {};
+};
+
+inline Glushkov::Glushkov(std::string_view postfix)
+{
+    for (auto ch : postfix) {
+        if (ch != '|' && ch != '^' && ch != '*' && ch != '+' && ch != '?')
+            ++_position_count;
+    }
+    _word_count = (_position_count + WORD_BITS) / WORD_BITS;
+    _follow.assign((_position_count + 1) * _word_count, 0);
+    _char_mask.assign(ALPHABET_SIZE * _word_count, 0);
+
+    auto set_bit = [](word_t* set, std::size_t bit) {
+        set[bit / WORD_BITS] |= word_t { 1 } << (bit % WORD_BITS);
+    };
+    auto unite = [this](std::vector<word_t>& set, const std::vector<word_t>& other) {
+        for (std::size_t w = 0; w < _word_count; ++w)
+            set[w] |= other[w];
+    };
+
+    std::vector<Fragment> stack {};
+    std::size_t position = 0;
+    for (auto ch : postfix) {
+        switch (ch) {
+            case '^': {
+                assert(stack.size() >= 2);
+                auto right = std::move(stack.back());
+                stack.pop_back();
+                auto& left = stack.back();
+
+                _addFollow(left.last, right.first);
+                if (left.nullable)
+                    unite(left.first, right.first);
+                if (right.nullable)
+                    unite(right.last, left.last);
+                left.last = std::move(right.last);
+                left.nullable = left.nullable && right.nullable;
+                break;
+            }
+            case '|': {
+                assert(stack.size() >= 2);
+                auto right = std::move(stack.back());
+                stack.pop_back();
+                auto& left = stack.back();
+
+                unite(left.first, right.first);
+                unite(left.last, right.last);
+                left.nullable = left.nullable || right.nullable;
+                break;
+            }
+            case '*':
+            case '+':
+                assert(!stack.empty());
+                _addFollow(stack.back().last, stack.back().first);
+                stack.back().nullable = stack.back().nullable || ch == '*';
+                break;
+            case '?':
+                assert(!stack.empty());
+                stack.back().nullable = true;
+                break;
+            default: {
+                ++position;
+                Fragment fragment { std::vector<word_t>(_word_count, 0),
+                                    std::vector<word_t>(_word_count, 0),
+                                    false };
+                set_bit(fragment.first.data(), position);
+                set_bit(fragment.last.data(), position);
+                set_bit(_row(_char_mask, static_cast<unsigned char>(ch)), position);
+                stack.push_back(std::move(fragment));
+                break;
+            }
+        }
+    }
+    assert(stack.size() == 1);
+
+    auto& regex = stack.back();
+    std::copy(regex.first.begin(), regex.first.end(), _row(_follow, 0));
+    _final = std::move(regex.last);
+    if (regex.nullable)
+        set_bit(_final.data(), 0);
+
+    if (_word_count <= MAX_TABLE_WORDS)
+        _buildFollowTable();
+}
+
+inline void Glushkov::_buildFollowTable()
+{
+    constexpr std::size_t CHUNK_VALUES = CHUNK_MASK + 1;
+    const auto chunk_count = _word_count * CHUNKS_PER_WORD;
+    _follow_table.assign(chunk_count * CHUNK_VALUES * _word_count, 0);
+
+    // every value is the one without its lowest bit plus the follow set of that bit
+    for (std::size_t chunk = 0; chunk < chunk_count; ++chunk) {
+        auto* table = _row(_follow_table, chunk * CHUNK_VALUES);
+        for (std::size_t value = 1; value < CHUNK_VALUES; ++value) {
+            const auto position = chunk * CHUNK_BITS + __builtin_ctzll(value);
+            auto* row = table + value * _word_count;
+            const auto* rest = table + (value & (value - 1)) * _word_count;
+            std::copy(rest, rest + _word_count, row);
+            if (position > _position_count)
+                continue;
+
+            const auto* follow = _row(_follow, position);
+            for (std::size_t w = 0; w < _word_count; ++w)
+                row[w] |= follow[w];
+        }
+    }
+}
+
+inline void Glushkov::_followUnion(const word_t* state, word_t* next) const noexcept
+{
+    // NOTE : a local copy, the stores to next may alias _word_count [both unsigned long]
+    const auto word_count = _word_count;
+    std::fill(next, next + word_count, 0);
+    auto unite = [next, word_count](const word_t* row) {
+        for (std::size_t i = 0; i < word_count; ++i)
+            next[i] |= row[i];
+    };
+
+    if (_follow_table.empty()) {
+        _forEachBit(state, word_count, [&](std::size_t position) { unite(_row(_follow, position)); });
+        return;
+    }
+
+    for (std::size_t w = 0; w < word_count; ++w) {
+        for (auto word = state[w]; word; word = _nextChunk(word))
+            unite(_chunkFollow(w, word));
+    }
+}
+
+inline void Glushkov::_addFollow(
+    const std::vector<word_t>& positions, const std::vector<word_t>& set) noexcept
+{
+    _forEachBit(positions.data(), _word_count, [&](std::size_t position) {
+        auto* follow = _row(_follow, position);
+        for (std::size_t w = 0; w < _word_count; ++w)
+            follow[w] |= set[w];
+    });
+}
+
+inline bool Glushkov::match(std::string_view str) const
+{
+    // a single word covers up to 63 positions [and the start], no buffers needed
+    if (_word_count == 1) {
+        word_t state = 1;
+        for (auto ch : str) {
+            word_t next = 0;
+            for (; state; state = _nextChunk(state))
+                next |= *_chunkFollow(0, state);
+            state = next & _char_mask[static_cast<unsigned char>(ch)];
+            if (!state)
+                return false;
+        }
+        return state & _final.front();
+    }
+
+    std::vector<word_t> state(_word_count, 0), next(_word_count, 0);
+    state.front() = 1;
+    for (auto ch : str) {
+        _followUnion(state.data(), next.data());
+
+        const auto* mask = _row(_char_mask, static_cast<unsigned char>(ch));
+        word_t any = 0;
+        for (std::size_t w = 0; w < _word_count; ++w)
+            any |= next[w] &= mask[w];
+        if (!any)
+            return false;
+        state.swap(next);
+    }
+
+    for (std::size_t w = 0; w < _word_count; ++w) {
+        if (state[w] & _final[w])
+            return true;
+    }
+    return false;
+}
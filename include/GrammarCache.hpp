@@ -0,0 +1,127 @@
+#pragma once
+#include <DFA.hpp>
+#include <FSA.hpp>
+#include <MappedDFA.hpp>
+#include <NFA.hpp>
+#include <cstdint>
+#include <filesystem>
+#include <fmt/format.h>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <unistd.h>
+
+/**
+ * @class GrammarCache
+ * @brief On-disk cache of compiled grammars, addressed by the hash of the rules
+ * an entry is the minimized DFA in the binary format [see MappedDFA], named <key>.dfa, so an
+ * unchanged grammar is mapped instead of built, and a changed one gets a new entry
+ * entries are written to a temporary file and renamed, several generators may share a directory
+ *
+ */
+class GrammarCache {
+public:
+    // regex -> (priority, type), as in src/main.cpp
+    using rules_t = NFA::rules_t;
+    using key_t = uint64_t;
+
+    // NOTE : bump it whenever the construction changes the built automaton
+    constexpr static uint32_t GENERATOR_VERSION = 1;
+
+public:
+    explicit GrammarCache(std::filesystem::path directory) noexcept:
+        _directory { std::move(directory) }
+    {
+    }
+
+public:
+    /**
+     * @brief Hash of the rules, the generator version and the binary format version
+     */
+    static key_t getKey(const rules_t& rules) noexcept;
+
+    std::filesystem::path getPath(const rules_t& rules) const
+    {
+        return _directory / fmt::format("{:016x}.dfa", getKey(rules));
+    }
+
+    /**
+     * @brief Map the entry of the rules, nullopt if there is none or it's damaged
+     */
+    std::optional<MappedDFA> find(const rules_t& rules) const;
+
+    /**
+     * @brief Save the DFA [built from the rules] as their entry
+     * return false if the entry can't be written
+     */
+    bool store(const rules_t& rules, const DFA& dfa) const;
+
+    /**
+     * @brief Map the entry of the rules, build, minimize and store it first on a miss
+     * return nullopt only if the directory isn't writable
+     */
+    std::optional<MappedDFA> getOrBuild(const rules_t& rules, std::size_t thread_count = 1) const;
+
+private:
+    std::filesystem::path _directory;
+};
+
+inline GrammarCache::key_t GrammarCache::getKey(const rules_t& rules) noexcept
+{
+    // INFO : the strings are length prefixed and the numbers end with a separator, so no two rule
+    // sets serialize the same
+    FSA::str_t data = fmt::format("{}:{}:{}\n", GENERATOR_VERSION, BinaryFormat::VERSION, rules.size());
+    for (const auto& [regex, value] : rules) {
+        const auto& [priority, type] = value;
+        data += fmt::format("{}:{}{}:{}:{}\n", regex.size(), regex, priority, type.size(), type);
+    }
+    return BinaryFormat::checksum(data);
+}
+
+inline std::optional<MappedDFA> GrammarCache::find(const rules_t& rules) const
+{
+    const auto path = getPath(rules);
+    std::error_code error {};
+    if (!std::filesystem::is_regular_file(path, error))
+        return std::nullopt;
+
+    MappedDFA mapped { path.string() };
+    if (!mapped.isValid())
+        return std::nullopt;
+    return mapped;
+}
+
+inline bool GrammarCache::store(const rules_t& rules, const DFA& dfa) const
+{
+    std::error_code error {};
+    std::filesystem::create_directories(_directory, error);
+    if (error)
+        return false;
+
+    // a reader never sees a partial entry
+    const auto path = getPath(rules);
+    auto temporary = path;
+    temporary += fmt::format(".{}.tmp", getpid());
+    if (!dfa.saveBinaryTo(temporary.string())) {
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    return true;
+}
+
+inline std::optional<MappedDFA> GrammarCache::getOrBuild(const rules_t& rules, std::size_t thread_count) const
+{
+    if (auto mapped = find(rules))
+        return mapped;
+
+    DFA dfa(NFA::fromRules(rules), thread_count);
+    dfa.minimal();
+    if (!store(rules, dfa))
+        return std::nullopt;
+    return find(rules);
+}
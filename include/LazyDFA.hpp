@@ -0,0 +1,203 @@
+#pragma once
+#include <FSA.hpp>
+#include <NFA.hpp>
+#include <Profile.hpp>
+#include <Subset.hpp>
+#include <array>
+#include <memory>
+#include <vector>
+
+/**
+ * @class LazyDFA
+ * @brief DFA built on demand from the NFA while scanning
+ * a state and its transitions are only computed when the input reaches them, and kept in a cache
+ * which is flushed once it grows over the memory budget
+ * NOTE : a flush invalidates every state id but the start state and the returned one, so a state
+ * is only valid until the next getNextState
+ *
+ */
+class LazyDFA: public FSA {
+public:
+    using char_class_t = uint16_t;
+    constexpr static std::size_t ALPHABET_SIZE = 256;
+    constexpr static std::size_t DEFAULT_BUDGET = 8 * 1024 * 1024;
+    // the transition is not computed yet
+    constexpr static state_t UNKNOWN_STATE = INVALID_STATE - 1;
+
+public:
+    /**
+     * @param nfa copied, the lazy DFA doesn't depend on it afterwards
+     * @param budget cache size in bytes
+     */
+    explicit LazyDFA(const NFA& nfa, std::size_t budget = DEFAULT_BUDGET);
+
+    // NOTE : copies share the NFA, but each one has its own cache
+    ~LazyDFA() = default;
+    LazyDFA(LazyDFA&&) = default;
+    LazyDFA(const LazyDFA&) = default;
+    LazyDFA& operator= (LazyDFA&&) = default;
+    LazyDFA& operator= (const LazyDFA&) = default;
+
+public:
+    /**
+     * @brief Get the next state, compute it on a cache miss
+     * return the dead state if there is no transition
+     */
+    state_t getNextState(state_t state, char_t ch)
+    {
+        const auto char_class = _char_class[static_cast<unsigned char>(ch)];
+        const auto next_state = _transition_table[state * _class_count + char_class];
+        if (next_state != UNKNOWN_STATE) [[likely]]
+            return next_state;
+        return _computeNextState(state, ch);
+    }
+
+    // the start state is always the first cached state
+    state_t getStartState() const noexcept
+    {
+        return 0;
+    }
+
+    state_t getDeadState() const noexcept
+    {
+        return INVALID_STATE;
+    }
+
+    bool isFinalState(state_t state) const noexcept
+    {
+        return _final_table[state];
+    }
+
+    kind_t getAcceptKind(state_t state) const noexcept
+    {
+        return _accept_table[state];
+    }
+
+    /**
+     * @brief Get the token type name of the given kind
+     * kinds are numbered in name order over every rule of the NFA
+     */
+    const state_info_t& getTokenName(kind_t kind) const noexcept
+    {
+        return _token_names[kind];
+    }
+
+    const std::vector<state_info_t>& getTokenNames() const noexcept
+    {
+        return _token_names;
+    }
+
+    std::size_t getCachedStateCount() const noexcept
+    {
+        return _sets.size();
+    }
+
+    /**
+     * @brief Get how many times the cache was flushed
+     */
+    std::size_t getResetCount() const noexcept
+    {
+        return _reset_count;
+    }
+
+    std::size_t getMemoryUsage() const noexcept
+    {
+        return _sets.getMemoryUsage() + _transition_table.size() * sizeof(state_t)
+             + _final_table.size() + _accept_table.size() * sizeof(kind_t);
+    }
+
+private:
+    state_t _computeNextState(state_t state, char_t ch);
+    state_t _addState(const SubsetConstruction::set_t& set);
+    void _reset();
+
+private:
+    std::shared_ptr<const NFA> _nfa {};
+    SubsetConstruction _subset;
+    std::size_t _budget {};
+
+    /**
+     * @brief byte -> class, every char of the charset has its own class
+     * class 0 holds the bytes out of the charset and always leads to the dead state
+     */
+    std::array<char_class_t, ALPHABET_SIZE> _char_class {};
+    size_t _class_count {};
+
+    // INFO : the cache, indexed by the ids of the interned sets
+    StateSetTable _sets {};
+    std::vector<state_t> _transition_table {};
+    std::vector<uint8_t> _final_table {};
+    std::vector<kind_t> _accept_table {};
+
+    std::vector<state_info_t> _token_names {};
+    map_t<state_info_t, kind_t> _kinds {};
+    SubsetConstruction::set_t _start_set {};
+    SubsetConstruction::set_t _next_set {};
+    std::size_t _reset_count {};
+};
+
+inline LazyDFA::LazyDFA(const NFA& nfa, std::size_t budget):
+    _nfa { std::make_shared<const NFA>(nfa) },
+    _subset { *_nfa },
+    _budget { budget }
+{
+    _class_count = 1;
+    for (auto ch : _nfa->getCharset())
+        _char_class[static_cast<unsigned char>(ch)] = _class_count++;
+
+    for (const auto& [state, info] : _nfa->getStateInfoMap())
+        _kinds.emplace(info.second, 0);
+    for (auto& [name, kind] : _kinds) {
+        kind = _token_names.size();
+        _token_names.push_back(name);
+    }
+
+    _subset.getStartSet(_start_set);
+    _addState(_start_set);
+}
+
+inline LazyDFA::state_t LazyDFA::_addState(const SubsetConstruction::set_t& set)
+{
+    auto [state, inserted] = _sets.intern(set);
+    if (!inserted)
+        return state;
+
+    PROFILE_COUNT("lazy_dfa.states", 1);
+    _transition_table.resize(_transition_table.size() + _class_count, UNKNOWN_STATE);
+    _transition_table[state * _class_count] = getDeadState();
+    _final_table.push_back(_subset.isFinal(set));
+    auto info = _subset.getStateInfo(set);
+    _accept_table.push_back(info ? _kinds.at(*info) : INVALID_KIND);
+    return state;
+}
+
+inline LazyDFA::state_t LazyDFA::_computeNextState(state_t state, char_t ch)
+{
+    _subset.move(_sets.get(state), ch, _next_set);
+    const auto index = state * _class_count + _char_class[static_cast<unsigned char>(ch)];
+    if (_next_set.empty()) {
+        _transition_table[index] = getDeadState();
+        return getDeadState();
+    }
+
+    // the transition is dropped with the flushed cache, the caller only keeps the new state
+    if (getMemoryUsage() > _budget) {
+        _reset();
+        return _addState(_next_set);
+    }
+
+    const auto next_state = _addState(_next_set);
+    _transition_table[index] = next_state;
+    return next_state;
+}
+
+inline void LazyDFA::_reset()
+{
+    ++_reset_count;
+    PROFILE_COUNT("lazy_dfa.resets", 1);
+    _sets.clear();
+    _transition_table.clear();
+    _final_table.clear();
+    _accept_table.clear();
+    _addState(_start_set);
+}
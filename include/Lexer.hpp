@@ -2,82 +2,460 @@
 #include <Buffer.hpp>
 #include <DFA.hpp>
 #include <Token.hpp>
+#include <algorithm>
+#include <LazyDFA.hpp>
+#include <MappedDFA.hpp>
+#include <Profile.hpp>
 #include <color.h>
+#include <concepts>
 #include <fmt/format.h>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief What the lexer needs from an automaton
+ * getNextState may be non-const [a lazy DFA fills its cache while scanning]
+ */
+template <typename automaton_t>
+concept automaton_c = requires(automaton_t automaton, FSA::state_t state, FSA::char_t ch) {
+    { automaton.getStartState() } -> std::convertible_to<FSA::state_t>;
+    { automaton.getDeadState() } -> std::convertible_to<FSA::state_t>;
+    { automaton.getNextState(state, ch) } -> std::convertible_to<FSA::state_t>;
+    { automaton.getAcceptKind(state) } -> std::convertible_to<FSA::kind_t>;
+    { automaton.getTokenName(FSA::kind_t {}) } -> std::convertible_to<std::string_view>;
+};
 
 // TODO : Add filename, line, column support
-class Lexer {
+template <automaton_c automaton_t>
+class BasicLexer {
 public:
+    using kind_t = FSA::kind_t;
+    using state_t = FSA::state_t;
 
 public:
-    Lexer() = delete;
-    Lexer& operator= (Lexer&&) = delete;
-    Lexer& operator= (const Lexer&) = delete;
+    BasicLexer() = delete;
+    BasicLexer& operator= (BasicLexer&&) = delete;
+    BasicLexer& operator= (const BasicLexer&) = delete;
 
-    ~Lexer() = default;
-    Lexer(Lexer&&) = default;
-    Lexer(const Lexer&) = default;
+    ~BasicLexer() = default;
+    BasicLexer(BasicLexer&&) = default;
+    BasicLexer(const BasicLexer&) = default;
 
-    Lexer(Buffer buf, const DFA& dfa);
+    /**
+     * @brief The lexer keeps its own copy of the automaton
+     */
+    BasicLexer(Buffer buf, const automaton_t& automaton);
 
 public:
+    /**
+     * @brief Skip the input no token matches instead of reporting it
+     * for finding tokens in mostly noise text, the noise is jumped over by the literal prefix
+     * or the first bytes of the tokens
+     */
+    void setSkipUnmatched(bool skip_unmatched = true) noexcept
+    {
+        _skip_unmatched = skip_unmatched;
+    }
+
     std::optional<Token> nextToken();
     std::vector<Token> getAllTokens();
 
+    /**
+     * @brief Tokenize the rest of the input into the given vector [cleared, capacity reused]
+     * the token values are views into the input, so the buffer must be contiguous
+     *
+     * @return the number of tokens
+     */
+    std::size_t getAllTokens(std::vector<Token>& tokens);
+
+    /**
+     * @brief Tokenize the rest of the input into the given list [cleared, capacity reused]
+     * works for streamed buffers as well, since only offsets and lengths are kept
+     *
+     * @return the number of tokens
+     */
+    std::size_t getAllTokens(TokenList& tokens);
+
+    /**
+     * @brief Tokenize the rest of a contiguous input on thread_count threads
+     * every chunk is lexed from a guessed token start, then the chunks are stitched at the first
+     * token start they share with the real token stream, the gaps are lexed again sequentially
+     * so the result is always the same as the single threaded one
+     *
+     * @param sync a char a token never continues past [e.g. '\n' for line oriented grammars],
+     * chunks then start right after it, which makes the guesses right in the first place
+     * @return the number of tokens
+     */
+    std::size_t getAllTokens(
+        TokenList& tokens, std::size_t thread_count, std::optional<char> sync = std::nullopt);
+
 private:
-    const DFA _dfa;
+    /**
+     * @brief Match the next token from the current position
+     * the buffer is left right after the lexeme, the unmatched input is skipped in skip mode,
+     * otherwise reported [exit]
+     *
+     * @param lexeme_start set to the start of the token
+     * @return the accepted token kind, INVALID_KIND at the end of input
+     */
+    kind_t _nextMatch(Buffer::pos_t& lexeme_start);
+
+    /**
+     * @brief Match the longest lexeme from the current position
+     * the buffer is left at the unexpected char and _error is set if nothing matches
+     */
+    kind_t _tryLongestMatch();
+
+    /**
+     * @brief Jump to the next position a token may start at
+     */
+    void _skipNoise();
+
+    /**
+     * @brief Get the length of the prefix of data no token starts in
+     */
+    std::size_t _countNoise(std::string_view data);
+
+    struct Guess
+    {
+        TokenList tokens;
+        // where the lexer started looking for each token [the token start without skipping]
+        std::vector<Buffer::pos_t> starts;
+        // where the guessed token stream stops
+        Buffer::pos_t end;
+    };
+
+    /**
+     * @brief Guess the tokens of [begin, end) of the input, stop at the first error
+     * NOTE : only on a lexer of its own, the main lexer keeps the real position
+     */
+    void _speculate(Buffer::pos_t begin, Buffer::pos_t end, Guess& guess);
+
+private:
+    automaton_t _automaton;
     Buffer _buffer;
 
 
-    DFA::state_t _current_state {};
-    // 4 padding
-    int32_t _padding {};
+    state_t _current_state {};
+    bool _error {};
+    bool _skip_unmatched {};
+
+    /**
+     * @brief the counts of nextToken, flushed at the end of input
+     */
+    [[no_unique_address]] Profile::Counter _token_counter { "lexer.tokens" };
+    [[no_unique_address]] Profile::Counter _byte_counter { "lexer.bytes" };
 };
 
-inline Lexer::Lexer(Buffer buf, const DFA& dfa):
-    _dfa(dfa),
-    _buffer(buf)
+using Lexer = BasicLexer<DFA>;
+using LazyLexer = BasicLexer<LazyDFA>;
+using MappedLexer = BasicLexer<MappedDFA>;
+
+template <automaton_c automaton_t>
+inline BasicLexer<automaton_t>::BasicLexer(Buffer buf, const automaton_t& automaton):
+    _automaton(automaton),
+    _buffer(std::move(buf))
 {
 }
 
-inline std::optional<Token> Lexer::nextToken()
+template <automaton_c automaton_t>
+inline FSA::kind_t BasicLexer<automaton_t>::_nextMatch(Buffer::pos_t& lexeme_start)
 {
-    _current_state = _dfa.getStartState();
-    _buffer.markLexemeStart();
-    DFA::state_t last_final_state = DFA::INVALID_STATE;
+    while (true) {
+        if (_skip_unmatched)
+            _skipNoise();
+
+        _buffer.markLexemeStart();
+        lexeme_start = _buffer.getPos();
+        const auto kind = _tryLongestMatch();
+        if (!_error)
+            return kind;
+
+        if (!_skip_unmatched) {
+            const auto ch = _buffer.peek();
+            std::cout << Color::Red
+                      << fmt::format(
+                             "Lexer error: Unexpected {} at line [{}], column [{}]",
+                             ch == Buffer::EOF_CHAR ? "end of input" : fmt::format("character {}", ch),
+                             _buffer.getLineNr(),
+                             _buffer.getColumn())
+                      << Color::Endl;
+            exit(1);
+        }
+
+        // no token starts here after all
+        _buffer.rollback(lexeme_start + 1);
+    }
+}
+
+template <automaton_c automaton_t>
+inline void BasicLexer<automaton_t>::_skipNoise()
+{
+    while (true) {
+        // let a streamed buffer drop the noise on refill
+        _buffer.markLexemeStart();
+        const auto lookahead = _buffer.lookahead();
+        if (lookahead.empty()) {
+            if (_buffer.peek() == Buffer::EOF_CHAR)
+                return;
+            continue;
+        }
+
+        const auto count = _countNoise(lookahead);
+        _buffer.skip(count);
+        if (count < lookahead.size())
+            return;
+    }
+}
+
+template <automaton_c automaton_t>
+inline std::size_t BasicLexer<automaton_t>::_countNoise(std::string_view data)
+{
+    if constexpr (requires { _automaton.getLiteralPrefix(); }) {
+        // every token starts with the prefix
+        const auto& prefix = _automaton.getLiteralPrefix();
+        if (!prefix.empty()) {
+            const auto found = data.find(prefix);
+            if (found != std::string_view::npos)
+                return found;
+
+            // the window may cut a prefix at its end
+            const auto count = data.size() - std::min(data.size(), prefix.size() - 1);
+            return count + std::min(data.substr(count).find(prefix.front()), data.size() - count);
+        }
+    }
+    if constexpr (requires { _automaton.getNoiseSet(); }) {
+        if (const auto* noise = _automaton.getNoiseSet())
+            return noise->countPrefix(data);
+    }
+
+    const auto start_state = _automaton.getStartState();
+    const auto dead_state = _automaton.getDeadState();
+    std::size_t count = 0;
+    while (count < data.size() && _automaton.getNextState(start_state, data[count]) == dead_state)
+        ++count;
+    return count;
+}
+
+template <automaton_c automaton_t>
+inline FSA::kind_t BasicLexer<automaton_t>::_tryLongestMatch()
+{
+    auto state = _automaton.getStartState();
+    const auto dead_state = _automaton.getDeadState();
+    const auto lexeme_start = _buffer.getPos();
+    kind_t last_kind = FSA::INVALID_KIND;
+    Buffer::pos_t last_final_pos = Buffer::INVALID_POS;
+    _error = false;
 
     while (true) {
         const auto ch = _buffer.peek();
-        if (ch == Buffer::EOF_CHAR)
+        if (ch == Buffer::EOF_CHAR) {
+            // a candidate cut by the end of input is an error as well, not the end of input
+            _error = last_kind == FSA::INVALID_KIND && _buffer.getPos() != lexeme_start;
             break;
+        }
 
-        const auto reached_state = _dfa.getReachedState(_current_state, ch);
-        if (!reached_state) {
-            if (last_final_state == DFA::INVALID_STATE) {
-                std::cout << Color::Red
-                          << fmt::format(
-                                 "Lexer error: Unexpected character {} at line [{}], column [{}]",
-                                 ch,
-                                 _buffer.getLineNr(),
-                                 _buffer.getColumn())
-                          << Color::Endl;
-                exit(1);
-            }
+        const auto reached_state = _automaton.getNextState(state, ch);
+        if (reached_state == dead_state) {
+            _error = last_kind == FSA::INVALID_KIND;
             break;
         }
 
-        _current_state = *reached_state;
+        state = reached_state;
         _buffer.next();
-        if (_dfa.isFinalState(_current_state))
-            last_final_state = _current_state;
+        if constexpr (requires { _automaton.getSelfLoop(state); }) {
+            // the state stays the same over the run, so does the accepted kind
+            if (const auto* loop = _automaton.getSelfLoop(state))
+                _buffer.skip(loop->countPrefix(_buffer.lookahead()));
+        }
+        if (const auto kind = _automaton.getAcceptKind(state); kind != FSA::INVALID_KIND) {
+            last_kind = kind;
+            last_final_pos = _buffer.getPos();
+        }
+    }
+    _current_state = state;
+
+    // longest match: give back the chars read after the last final state
+    if (last_kind != FSA::INVALID_KIND)
+        _buffer.rollback(last_final_pos);
+    return last_kind;
+}
+
+template <automaton_c automaton_t>
+inline std::optional<Token> BasicLexer<automaton_t>::nextToken()
+{
+    [[maybe_unused]] const auto begin = _buffer.getPos();
+    Buffer::pos_t lexeme_start {};
+    const auto kind = _nextMatch(lexeme_start);
+    if (kind == FSA::INVALID_KIND) {
+        _token_counter.flush();
+        _byte_counter.flush();
+        return std::nullopt;
     }
 
+    _token_counter.add(1);
+    _byte_counter.add(_buffer.getPos() - begin);
+
     // clang-format off
-    return last_final_state == DFA::INVALID_STATE
-             ? std::nullopt
-             : std::make_optional<Token>(Token {
-                 .type = _dfa.getStateInfo(last_final_state),
-                 .value = _buffer.takeLexeme(),
-             });
+    return Token {
+        .kind = kind,
+        .type = _automaton.getTokenName(kind),
+        .value = _buffer.takeLexeme(),
+        .offset = lexeme_start,
+    };
     // clang-format on
 }
+
+template <automaton_c automaton_t>
+inline std::vector<Token> BasicLexer<automaton_t>::getAllTokens()
+{
+    std::vector<Token> tokens {};
+    getAllTokens(tokens);
+    return tokens;
+}
+
+template <automaton_c automaton_t>
+inline std::size_t BasicLexer<automaton_t>::getAllTokens(std::vector<Token>& tokens)
+{
+    PROFILE_SCOPE("lexer.scan");
+    assert(_buffer.isContiguous());
+    tokens.clear();
+
+    [[maybe_unused]] const auto begin = _buffer.getPos();
+    while (true) {
+        Buffer::pos_t lexeme_start {};
+        const auto kind = _nextMatch(lexeme_start);
+        if (kind == FSA::INVALID_KIND)
+            break;
+
+        // clang-format off
+        tokens.push_back(Token {
+            .kind = kind,
+            .type = _automaton.getTokenName(kind),
+            .value = _buffer.takeLexeme(),
+            .offset = lexeme_start,
+        });
+        // clang-format on
+    }
+    PROFILE_COUNT("lexer.tokens", tokens.size());
+    PROFILE_COUNT("lexer.bytes", _buffer.getPos() - begin);
+    return tokens.size();
+}
+
+template <automaton_c automaton_t>
+inline std::size_t BasicLexer<automaton_t>::getAllTokens(TokenList& tokens)
+{
+    PROFILE_SCOPE("lexer.scan");
+    tokens.clear();
+
+    [[maybe_unused]] const auto begin = _buffer.getPos();
+    while (true) {
+        Buffer::pos_t lexeme_start {};
+        const auto kind = _nextMatch(lexeme_start);
+        if (kind == FSA::INVALID_KIND)
+            break;
+
+        tokens.push(kind, lexeme_start, _buffer.getPos() - lexeme_start);
+    }
+    PROFILE_COUNT("lexer.tokens", tokens.size());
+    PROFILE_COUNT("lexer.bytes", _buffer.getPos() - begin);
+    return tokens.size();
+}
+
+template <automaton_c automaton_t>
+inline void BasicLexer<automaton_t>::_speculate(
+    Buffer::pos_t begin, Buffer::pos_t end, Guess& guess)
+{
+    _buffer.rollback(begin);
+    while (true) {
+        guess.end = _buffer.getPos();
+        if (guess.end >= end)
+            return;
+
+        // the skip mode never fails, a guess only stops at an error without it
+        Buffer::pos_t lexeme_start = guess.end;
+        const auto kind = _skip_unmatched ? _nextMatch(lexeme_start) : _tryLongestMatch();
+        if (kind == FSA::INVALID_KIND)
+            return;
+
+        guess.tokens.push(kind, lexeme_start, _buffer.getPos() - lexeme_start);
+        guess.starts.push_back(guess.end);
+    }
+}
+
+template <automaton_c automaton_t>
+inline std::size_t BasicLexer<automaton_t>::getAllTokens(
+    TokenList& tokens, std::size_t thread_count, std::optional<char> sync)
+{
+    constexpr std::size_t MIN_CHUNK_SIZE = 64 * 1024;
+    PROFILE_SCOPE("lexer.scan");
+    assert(_buffer.isContiguous());
+    tokens.clear();
+
+    const auto input = _buffer.view();
+    const auto begin = _buffer.getPos();
+    const auto chunk_count = std::clamp<std::size_t>(
+        (input.size() - begin) / MIN_CHUNK_SIZE, 1, std::max<std::size_t>(thread_count, 1));
+
+    // INFO : chunk i guesses the tokens of [bounds[i], bounds[i + 1])
+    std::vector<Buffer::pos_t> bounds { begin };
+    for (std::size_t i = 1; i < chunk_count; ++i) {
+        auto bound = begin + (input.size() - begin) * i / chunk_count;
+        if (sync) {
+            auto found = input.find(*sync, bound);
+            bound = found == std::string_view::npos ? input.size() : found + 1;
+        }
+        bounds.push_back(std::max(bound, bounds.back()));
+    }
+    bounds.push_back(input.size());
+
+    std::vector<Guess> guesses(chunk_count);
+    {
+        auto speculate = [&](std::size_t i) {
+            BasicLexer lexer { Buffer { input }, _automaton };
+            lexer._skip_unmatched = _skip_unmatched;
+            lexer._speculate(bounds[i], bounds[i + 1], guesses[i]);
+        };
+        std::vector<std::jthread> threads {};
+        for (std::size_t i = 1; i < chunk_count; ++i)
+            threads.emplace_back(speculate, i);
+        speculate(0);
+    }
+
+    // INFO : lexing is stateless between tokens, so once the real stream looks for a token
+    // where a guess did, the rest of the guess is right
+    auto pos = begin;
+    for (std::size_t i = 0; i < chunk_count; ++i) {
+        const auto& guess = guesses[i];
+        while (pos < bounds[i + 1]) {
+            auto it = std::ranges::lower_bound(guess.starts, pos);
+            if (it != guess.starts.end() && *it == pos) {
+                const auto first = it - guess.starts.begin();
+                const auto& guessed = guess.tokens;
+                tokens.kinds.insert(tokens.kinds.end(), guessed.kinds.begin() + first, guessed.kinds.end());
+                tokens.offsets.insert(
+                    tokens.offsets.end(), guessed.offsets.begin() + first, guessed.offsets.end());
+                tokens.lengths.insert(
+                    tokens.lengths.end(), guessed.lengths.begin() + first, guessed.lengths.end());
+                pos = guess.end;
+                continue;
+            }
+
+            // the guess is off here, lex one real token
+            _buffer.rollback(pos);
+            Buffer::pos_t lexeme_start {};
+            const auto kind = _nextMatch(lexeme_start);
+            pos = _buffer.getPos();
+            // only at the end of input, which ends every chunk as well
+            if (kind == FSA::INVALID_KIND)
+                break;
+            tokens.push(kind, lexeme_start, pos - lexeme_start);
+        }
+    }
+    _buffer.rollback(pos);
+    PROFILE_COUNT("lexer.tokens", tokens.size());
+    PROFILE_COUNT("lexer.bytes", pos - begin);
+    return tokens.size();
+}
@@ -0,0 +1,237 @@
+#pragma once
+#include <FSA.hpp>
+#include <MappedFile.hpp>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Binary format of a compiled DFA, written by DFA::saveBinaryTo and mapped by MappedDFA
+ * every section is a flat array in the byte order of the writer, so loading is a mapping and
+ * a few bound checks, there is nothing to parse
+ *
+ *     header_t
+ *     uint8_t  char_class[256]
+ *     uint32_t transition_table[row_count * class_count]   row = state, the last row is dead
+ *     uint32_t accept_table[row_count]                      INVALID_KIND if not final
+ *     uint32_t token_offsets[token_count + 1]               the names in the string pool
+ *     char     string_pool[string_pool_size]
+ */
+namespace BinaryFormat {
+constexpr std::array<char, 8> MAGIC { 'L', 'E', 'X', 'D', 'F', 'A', '\0', '\0' };
+constexpr uint32_t VERSION = 1;
+// read back as another value on a machine of the other byte order
+constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+constexpr std::size_t ALPHABET_SIZE = 256;
+
+struct header_t
+{
+    std::array<char, 8> magic;
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t row_count;
+    uint32_t class_count;
+    uint32_t start_state;
+    uint32_t dead_state;
+    uint32_t token_count;
+    uint32_t string_pool_size;
+    // the bytes after the header
+    uint64_t payload_size;
+    // checksum of the payload
+    uint64_t checksum;
+};
+
+static_assert(sizeof(header_t) == 56);
+
+/**
+ * @brief FNV-1a, one pass over the payload
+ */
+inline uint64_t checksum(std::string_view data) noexcept
+{
+    uint64_t hash = 0xcbf29ce484222325;
+    for (auto ch : data) {
+        hash ^= static_cast<unsigned char>(ch);
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+inline uint64_t getPayloadSize(const header_t& header) noexcept
+{
+    return ALPHABET_SIZE
+           + sizeof(uint32_t)
+                 * (uint64_t { header.row_count } * header.class_count + header.row_count
+                    + header.token_count + 1)
+           + header.string_pool_size;
+}
+} // namespace BinaryFormat
+
+/**
+ * @class MappedDFA
+ * @brief A DFA compiled by the generator, mapped read-only from its binary file
+ * it scans like DFA [see automaton_c] straight from the mapping, copies share the mapping,
+ * so handing it to a lexer is free
+ *
+ */
+class MappedDFA {
+public:
+    using state_t = FSA::state_t;
+    using kind_t = FSA::kind_t;
+    using char_t = FSA::char_t;
+
+public:
+    MappedDFA() = default;
+
+    /**
+     * @param verify check the payload checksum and the table bounds, one pass over the file
+     * without it, loading only checks the header, for files the generator just wrote
+     * see isValid for whether the file could be loaded
+     */
+    explicit MappedDFA(const std::string& filename, bool verify = true) noexcept;
+
+public:
+    /**
+     * @brief Whether the file is a well formed DFA of this format version
+     */
+    bool isValid() const noexcept
+    {
+        return _file != nullptr;
+    }
+
+    state_t getStartState() const noexcept
+    {
+        return _header->start_state;
+    }
+
+    state_t getDeadState() const noexcept
+    {
+        return _header->dead_state;
+    }
+
+    std::size_t getStateCount() const noexcept
+    {
+        return _header->row_count - 1;
+    }
+
+    std::size_t getClassCount() const noexcept
+    {
+        return _header->class_count;
+    }
+
+    uint8_t getCharClass(char_t ch) const noexcept
+    {
+        return _char_class[static_cast<unsigned char>(ch)];
+    }
+
+    state_t getNextState(state_t state, char_t ch) const noexcept
+    {
+        return _transition_table[state * _header->class_count + getCharClass(ch)];
+    }
+
+    bool isFinalState(state_t state) const noexcept
+    {
+        return getAcceptKind(state) != FSA::INVALID_KIND;
+    }
+
+    kind_t getAcceptKind(state_t state) const noexcept
+    {
+        return _accept_table[state];
+    }
+
+    std::size_t getTokenCount() const noexcept
+    {
+        return _header->token_count;
+    }
+
+    /**
+     * @brief Get the token type name of the given kind, a view into the mapping
+     */
+    std::string_view getTokenName(kind_t kind) const noexcept
+    {
+        return _string_pool.substr(_token_offsets[kind], _token_offsets[kind + 1] - _token_offsets[kind]);
+    }
+
+private:
+    /**
+     * @brief Point the sections into the file, false if it isn't a valid DFA
+     */
+    bool _load(std::string_view data, bool verify) noexcept;
+
+private:
+    std::shared_ptr<const MappedFile> _file {};
+
+    // INFO : the sections, views into the mapping
+    const BinaryFormat::header_t* _header {};
+    const uint8_t* _char_class {};
+    const uint32_t* _transition_table {};
+    const uint32_t* _accept_table {};
+    const uint32_t* _token_offsets {};
+    std::string_view _string_pool {};
+};
+
+inline MappedDFA::MappedDFA(const std::string& filename, bool verify) noexcept
+{
+    auto file = std::make_shared<const MappedFile>(filename);
+    if (file->isOpen() && _load(file->view(), verify))
+        _file = std::move(file);
+}
+
+inline bool MappedDFA::_load(std::string_view data, bool verify) noexcept
+{
+    using namespace BinaryFormat;
+    // the mapping is page aligned, so are the sections [every offset is a multiple of 4]
+    if (data.size() < sizeof(header_t))
+        return false;
+
+    const auto* header = reinterpret_cast<const header_t*>(data.data());
+    if (header->magic != MAGIC || header->version != VERSION || header->byte_order != BYTE_ORDER_MARK)
+        return false;
+    if (header->row_count == 0 || header->class_count == 0 || header->class_count > ALPHABET_SIZE
+        || header->start_state >= header->row_count || header->dead_state >= header->row_count)
+        return false;
+
+    const auto payload = data.substr(sizeof(header_t));
+    if (header->payload_size != payload.size() || getPayloadSize(*header) != payload.size())
+        return false;
+    if (verify && checksum(payload) != header->checksum)
+        return false;
+
+    const auto* cursor = payload.data();
+    auto take = [&cursor]<typename T>(std::size_t count, const T*& section) {
+        section = reinterpret_cast<const T*>(cursor);
+        cursor += count * sizeof(T);
+    };
+    take(ALPHABET_SIZE, _char_class);
+    take(std::size_t { header->row_count } * header->class_count, _transition_table);
+    take(header->row_count, _accept_table);
+    take(header->token_count + 1, _token_offsets);
+    _string_pool = { cursor, header->string_pool_size };
+    _header = header;
+
+    // INFO : the small sections are always checked, the tables only along with the checksum
+    for (std::size_t byte = 0; byte < ALPHABET_SIZE; ++byte) {
+        if (_char_class[byte] >= header->class_count)
+            return false;
+    }
+    for (uint32_t kind = 0; kind < header->token_count; ++kind) {
+        if (_token_offsets[kind] > _token_offsets[kind + 1])
+            return false;
+    }
+    if (_token_offsets[header->token_count] > header->string_pool_size)
+        return false;
+    if (!verify)
+        return true;
+
+    const auto cell_count = std::size_t { header->row_count } * header->class_count;
+    for (std::size_t cell = 0; cell < cell_count; ++cell) {
+        if (_transition_table[cell] >= header->row_count)
+            return false;
+    }
+    for (uint32_t state = 0; state < header->row_count; ++state) {
+        if (_accept_table[state] != FSA::INVALID_KIND && _accept_table[state] >= header->token_count)
+            return false;
+    }
+    return true;
+}
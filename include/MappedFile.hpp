@@ -0,0 +1,98 @@
+#pragma once
+#include <fcntl.h>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+/**
+ * @class MappedFile
+ * @brief RAII read-only memory mapping of a whole file
+ * see isOpen for whether the file could be mapped [an empty file is open with no data]
+ *
+ */
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& filename) noexcept;
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator= (const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept:
+        _data { std::exchange(other._data, nullptr) },
+        _size { std::exchange(other._size, 0) },
+        _opened { std::exchange(other._opened, false) }
+    {
+    }
+
+    MappedFile& operator= (MappedFile&& other) noexcept
+    {
+        if (this != &other) {
+            _unmap();
+            _data = std::exchange(other._data, nullptr);
+            _size = std::exchange(other._size, 0);
+            _opened = std::exchange(other._opened, false);
+        }
+        return *this;
+    }
+
+    ~MappedFile()
+    {
+        _unmap();
+    }
+
+public:
+    std::string_view view() const noexcept
+    {
+        return { static_cast<const char*>(_data), _size };
+    }
+
+    bool isOpen() const noexcept
+    {
+        return _opened;
+    }
+
+private:
+    void _unmap() noexcept
+    {
+        if (_data)
+            munmap(_data, _size);
+    }
+
+private:
+    void* _data {};
+    std::size_t _size {};
+    bool _opened {};
+};
+
+inline MappedFile::MappedFile(const std::string& filename) noexcept
+{
+    // a missing or unmappable file leaves isOpen false, the callers report it [see MappedDFA]
+    auto fd = open(filename.c_str(), O_RDONLY);
+    if (fd == -1)
+        return;
+
+    struct stat st {};
+    if (fstat(fd, &st) == 0) {
+        _opened = true;
+        _size = static_cast<std::size_t>(st.st_size);
+    }
+
+    // mmap can't map an empty file
+    if (_size != 0) {
+        auto data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            _size = 0;
+            _opened = false;
+        }
+        else {
+            _data = data;
+            // the lexer walks the file front to back
+            madvise(_data, _size, MADV_SEQUENTIAL);
+        }
+    }
+    close(fd);
+}
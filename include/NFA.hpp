@@ -1,16 +1,22 @@
 #pragma once
 #include <FSA.hpp>
+#include <Glushkov.hpp>
+#include <Profile.hpp>
 #include <Util.hpp>
+#include <algorithm>
 #include <cassert>
 #include <color.h>
 #include <cstdint>
 #include <fmt/format.h>
 #include <fstream>
+#include <memory>
 #include <optional>
+#include <span>
 #include <stack>
 #include <string>
 #include <string_view>
 #include <utility>
+#include <vector>
 
 // NOTE : Comments are grenarated by GPT4
 
@@ -28,9 +34,21 @@ public: // INFO : type alias
     // clang-format off
     using priority_t = int32_t;
     using str_view_t = std::string_view;
-    using epsilon_transition_map_t = FSA::map_t<state_t, NFA::state_set_t>;
+    // regex -> (priority, token type)
+    using rules_t = map_t<str_t, std::pair<priority_t, str_t>>;
     // clang-format on
 
+    /**
+     * @brief A state of Thompson's construction
+     * it has either one char transition or up to two epsilon transitions
+     */
+    struct State
+    {
+        state_t next { INVALID_STATE };
+        state_t epsilon[2] { INVALID_STATE, INVALID_STATE };
+        char_t ch {};
+    };
+
 public: // INFO : built-in method
     // Define default and copy constructors, and assignment operators
     NFA() = default;
@@ -57,6 +75,17 @@ public: // INFO : member method
 
     void clear() noexcept;
     NFA& operator+ (NFA& rhs) noexcept;
+
+    /**
+     * @brief The union of the NFA of every rule, in the order of the rules
+     */
+    static NFA fromRules(const rules_t& rules) noexcept;
+
+    /**
+     * @brief Whether the whole string matches the NFA, without building a DFA
+     * simulated by the bit-parallel Glushkov automaton of the postfix, built on the first call
+     * NOTE : like the closure cache, call it once before sharing a const NFA between threads
+     */
     bool match(const str_view_t& str) const noexcept;
 
 
@@ -80,11 +109,32 @@ public: // INFO : member method
     std::optional<state_set_t>
         getReachedStates(const state_set_t& state_set, char_t ch) const noexcept;
 
-    // TODO :
     void getReachedStates(const state_t state, state_set_t& reached_states) const noexcept;
     void getReachedStates(
         const state_t state, char_t ch, state_set_t& reached_states) const noexcept;
 
+    /**
+     * @brief Get the sorted epsilon closure of the state [the state itself included]
+     * the closures are computed once for the whole NFA on the first call
+     */
+    std::span<const state_t> getEpsilonClosure(const state_t state) const noexcept
+    {
+        buildClosureCache();
+        auto component = _closure_component[state];
+        return { _closures.data() + _closure_offsets[component],
+                 _closures.data() + _closure_offsets[component + 1] };
+    }
+
+    /**
+     * @brief Compute the epsilon closure of every state if it's not done yet
+     * NOTE : call it before sharing a const NFA between threads
+     */
+    void buildClosureCache() const noexcept
+    {
+        if (_closure_component.size() != _states.size())
+            _buildClosureCache();
+    }
+
     // Getters for charset, start state, and final state
     set_t<char_t> getCharset() const noexcept
     {
@@ -96,6 +146,33 @@ public: // INFO : member method
         return _start_state;
     }
 
+    state_t getFinalState() const noexcept
+    {
+        return _final_state;
+    }
+
+    size_t getStateCount() const noexcept
+    {
+        return _states.size();
+    }
+
+    /**
+     * @brief Get the number of char and epsilon transitions
+     */
+    size_t getTransitionCount() const noexcept
+    {
+        size_t count = 0;
+        for (const auto& state : _states)
+            count += (state.next != INVALID_STATE) + (state.epsilon[0] != INVALID_STATE)
+                   + (state.epsilon[1] != INVALID_STATE);
+        return count;
+    }
+
+    const State& getState(const state_t state) const noexcept
+    {
+        return _states[state];
+    }
+
     bool hasFinalState(const set_t<state_t> set) const noexcept
     {
         return set.count(_final_state) == 1;
@@ -108,6 +185,11 @@ public: // INFO : member method
                                              : std::nullopt;
     }
 
+    const map_t<state_t, std::pair<priority_t, str_t>>& getStateInfoMap() const noexcept
+    {
+        return _state_info;
+    }
+
 public: // INFO : static method
     // Static method to get state information
     void printStateInfo() const
@@ -121,13 +203,24 @@ public: // INFO : static method
     }
 
 
-private: // INFO : private static member method
-    static state_t _newState()
+private: // INFO : private member method
+    state_t _newState()
+    {
+        _closure_component.clear();
+        _states.emplace_back();
+        return _states.size() - 1;
+    }
+
+    void _addEpsilon(const state_t from, const state_t to) noexcept
     {
-        return _state_count++;
+        _closure_component.clear();
+        auto& epsilon = _states[from].epsilon;
+        assert(epsilon[1] == INVALID_STATE);
+        epsilon[epsilon[0] == INVALID_STATE ? 0 : 1] = to;
     }
 
     __attribute__((used)) str_t toDotString() noexcept;
+    void _buildClosureCache() const noexcept;
 
 private: // INFO : private member method
     // Private methods to output the NFA to different formats
@@ -142,23 +235,28 @@ private: // INFO : private member method
 
 
 private: // INFO : private member variable
-    transition_map_t _state_transition_map {};
-    epsilon_transition_map_t _epsilon_transition_map {};
+    std::vector<State> _states {};
     state_t _start_state {};
     state_t _final_state {};
 
 
 private:
-    static map_t<state_t, std::pair<priority_t, str_t>> _state_info;
-    static size_t _state_count;
+    map_t<state_t, std::pair<priority_t, str_t>> _state_info {};
     str_t _RE {};
     str_t _postfix {};
     set_t<char_t> _charset;
     str_t _pre_process {};
-};
 
-inline NFA::size_t NFA::_state_count {};
-inline FSA::map_t<NFA::state_t, std::pair<NFA::priority_t, NFA::str_t>> NFA::_state_info {};
+private:
+    // INFO : epsilon closure cache, states in one epsilon cycle [strongly connected component]
+    // share the same closure, the closures of the components are stored in CSR layout
+    mutable std::vector<state_t> _closure_component {};
+    mutable std::vector<std::size_t> _closure_offsets {};
+    mutable std::vector<state_t> _closures {};
+
+    // INFO : the matcher of match(), shared by the copies
+    mutable std::shared_ptr<const Glushkov> _glushkov {};
+};
 
 /*
  *
@@ -179,47 +277,31 @@ inline std::ostream& operator<< (std::ostream& os, const NFA& nfa) noexcept
     os << Green << "start : " << End << nfa._start_state << '\n';
     os << Green << "end : " << End << nfa._final_state << '\n';
     os << Green << "transition : \n";
-    for (const auto& [key, value] : nfa._state_transition_map) {
-        os << Blue << key.first << End << " -" << Blue << key.second << End << "-> " << value
-           << '\n';
+    for (NFA::state_t state = 0; state < nfa._states.size(); ++state) {
+        const auto& s = nfa._states[state];
+        if (s.next != NFA::INVALID_STATE)
+            os << Blue << state << End << " -" << Blue << s.ch << End << "-> " << s.next << '\n';
     }
 
 
     os << Green << "epsilon transition : \n" << End;
-    for (const auto& [key, value] : nfa._epsilon_transition_map) {
-        os << Yellow << (key) << End << " -"
+    for (NFA::state_t state = 0; state < nfa._states.size(); ++state) {
+        const auto& s = nfa._states[state];
+        if (s.epsilon[0] == NFA::INVALID_STATE)
+            continue;
+
+        os << Yellow << (state) << End << " -"
            << "epsilon"
            << "-> ";
-        for (const auto& v : value) {
-            os << v << ' ';
+        for (const auto& v : s.epsilon) {
+            if (v != NFA::INVALID_STATE)
+                os << v << ' ';
         }
         os << '\n';
     }
     return os;
 }
 
-template <>
-struct fmt::formatter<NFA::epsilon_transition_map_t>
-{
-    // auto parse(format_parse_context& ctx) { return ctx.begin(); }
-    constexpr auto parse(format_parse_context& ctx)
-    {
-        return ctx.begin();
-    }
-
-    template <typename FormatContext>
-    auto format(NFA::epsilon_transition_map_t& m, FormatContext& ctx)
-    {
-        auto out = ctx.out();
-        for (const auto& [key, value] : m) {
-            for (const auto& state : value) {
-                out = format_to(ctx.out(), "{} -> {} [ label = \"ε\" ];\n", key, state);
-            }
-        }
-        return out;
-    }
-};
-
 inline void NFA::_toMarkdown(std::ostream& os) noexcept
 {
     using namespace fmt::literals;
@@ -247,6 +329,18 @@ inline void NFA::_toDotFile(std::ostream& os) noexcept
 inline NFA::str_t NFA::toDotString() noexcept
 {
     using namespace fmt::literals;
+    str_t transitions {}, epsilon_transitions {};
+    for (state_t state = 0; state < _states.size(); ++state) {
+        const auto& s = _states[state];
+        if (s.next != INVALID_STATE)
+            transitions += fmt::format("{} -> {} [ label = \"{}\" ];\n", state, s.next, s.ch);
+
+        for (auto to : s.epsilon) {
+            if (to != INVALID_STATE)
+                epsilon_transitions += fmt::format("{} -> {} [ label = \"ε\" ];\n", state, to);
+        }
+    }
+
     return fmt::format(
         "digraph NFA {{\n"
         "{graph_style}"
@@ -261,8 +355,8 @@ inline NFA::str_t NFA::toDotString() noexcept
         "graph_style"_a = graph_style,
         "start"_a = _start_state,
         "end"_a = _final_state,
-        "_state_transition_map"_a = _state_transition_map,
-        "_epsilon_transition_map"_a = _epsilon_transition_map);
+        "_state_transition_map"_a = transitions,
+        "_epsilon_transition_map"_a = epsilon_transitions);
 }
 
 // inline str
@@ -288,8 +382,11 @@ inline void NFA::_toImage(const str_t& filename) noexcept
 
 inline void NFA::clear() noexcept
 {
-    _state_transition_map.clear();
-    _epsilon_transition_map.clear();
+    _states.clear();
+    _closure_component.clear();
+    _glushkov.reset();
+    _state_info.clear();
+    _charset.clear();
     _start_state = _final_state = 0;
     _RE.clear();
     _postfix.clear();
@@ -312,6 +409,7 @@ inline void NFA::parse(NFA::str_t& RE) noexcept
     Util::getPostfixAndChatSet(RE, _charset);
     _postfix = RE;
 
+    PROFILE_SCOPE("nfa.thompson");
 
 
     auto Kleene = [this, &st]() {
@@ -319,11 +417,11 @@ inline void NFA::parse(NFA::str_t& RE) noexcept
         assert(st.size() >= 1);
         auto [start, end] = st.top();
 
-        _epsilon_transition_map[new_start].emplace(start);
-        _epsilon_transition_map[new_start].emplace(new_end);
+        _addEpsilon(new_start, start);
+        _addEpsilon(new_start, new_end);
 
-        _epsilon_transition_map[end].emplace(start);
-        _epsilon_transition_map[end].emplace(new_end);
+        _addEpsilon(end, start);
+        _addEpsilon(end, new_end);
 
         st.top() = { new_start, new_end };
     };
@@ -334,7 +432,7 @@ inline void NFA::parse(NFA::str_t& RE) noexcept
         st.pop();
         auto [start2, end2] = st.top();
 
-        _epsilon_transition_map[end2].emplace(start1);
+        _addEpsilon(end2, start1);
 
         st.top() = { start2, end1 };
     };
@@ -346,18 +444,19 @@ inline void NFA::parse(NFA::str_t& RE) noexcept
         st.pop();
         auto [start2, end2] = st.top();
 
-        _epsilon_transition_map[new_start].emplace(start1);
-        _epsilon_transition_map[new_start].emplace(start2);
+        _addEpsilon(new_start, start1);
+        _addEpsilon(new_start, start2);
 
-        _epsilon_transition_map[end1].emplace(new_end);
-        _epsilon_transition_map[end2].emplace(new_end);
+        _addEpsilon(end1, new_end);
+        _addEpsilon(end2, new_end);
 
         st.top() = { new_start, new_end };
     };
 
     auto Char = [this, &st](const char_t ch) {
         auto start = _newState(), end = _newState();
-        _state_transition_map[{ start, ch }] = end;
+        _states[start].ch = ch;
+        _states[start].next = end;
         st.push({ start, end });
     };
 
@@ -368,9 +467,9 @@ inline void NFA::parse(NFA::str_t& RE) noexcept
         auto [start, end] = st.top();
         // st.pop();
 
-        _epsilon_transition_map[new_start].emplace(start);
-        _epsilon_transition_map[end].emplace(new_end);
-        _epsilon_transition_map[end].emplace(start);
+        _addEpsilon(new_start, start);
+        _addEpsilon(end, new_end);
+        _addEpsilon(end, start);
 
         // st.push({ new_start, new_end });
         st.top() = { new_start, new_end };
@@ -381,10 +480,10 @@ inline void NFA::parse(NFA::str_t& RE) noexcept
         auto new_start = _newState(), new_end = _newState();
         auto [start, end] = st.top();
 
-        _epsilon_transition_map[new_start].emplace(start);
-        _epsilon_transition_map[new_start].emplace(new_end);
+        _addEpsilon(new_start, start);
+        _addEpsilon(new_start, new_end);
 
-        _epsilon_transition_map[end].emplace(new_end);
+        _addEpsilon(end, new_end);
 
         st.top() = { new_start, new_end };
     };
@@ -433,33 +532,78 @@ inline void NFA::parse(NFA::str_t& RE, str_t& info, NFA::priority_t priority) no
 
 inline NFA& NFA::operator+ (NFA& other) noexcept
 {
-    _state_transition_map.merge(other._state_transition_map);
-    _epsilon_transition_map.merge(other._epsilon_transition_map);
-    _charset.merge(other._charset);
+    PROFILE_SCOPE("nfa.union");
+    // the union with an empty NFA is the other NFA
+    if (_states.empty()) {
+        *this = other;
+        return *this;
+    }
+    // the loops below append to the containers they would read from
+    if (&other == this) {
+        auto copy = other;
+        return *this + copy;
+    }
+
+    // INFO : state ids are local to each NFA, so the other states are appended after this ones
+    const auto offset = static_cast<state_t>(_states.size());
+    auto shift = [offset](state_t state) {
+        return state == INVALID_STATE ? state : state + offset;
+    };
+
+    // NOTE : no exact reserve, it would defeat the geometric growth when many rules are unioned one
+    // by one and copy every state again on each union
+    for (auto state : other._states) {
+        state.next = shift(state.next);
+        state.epsilon[0] = shift(state.epsilon[0]);
+        state.epsilon[1] = shift(state.epsilon[1]);
+        _states.push_back(state);
+    }
+    for (const auto& [state, info] : other._state_info)
+        _state_info.emplace(state + offset, info);
+    _charset.insert(other._charset.begin(), other._charset.end());
+    // the postfix of the union is both postfix followed by the union operator
+    _postfix += other._postfix;
+    _postfix += '|';
+    _glushkov.reset();
 
 
     auto new_start = _newState();
     auto new_end = _newState();
 
-    _epsilon_transition_map[new_start].emplace(_start_state);
-    _epsilon_transition_map[new_start].emplace(other._start_state);
-    _epsilon_transition_map[_final_state].emplace(new_end);
-    _epsilon_transition_map[other._final_state].emplace(new_end);
+    _addEpsilon(new_start, _start_state);
+    _addEpsilon(new_start, other._start_state + offset);
+    _addEpsilon(_final_state, new_end);
+    _addEpsilon(other._final_state + offset, new_end);
 
     _start_state = new_start;
     _final_state = new_end;
     return *this;
 }
 
+inline NFA NFA::fromRules(const rules_t& rules) noexcept
+{
+    NFA nfa {};
+    for (const auto& [regex, value] : rules) {
+        auto re = regex;
+        auto info = value.second;
+        auto tmp = NFA(re, info, value.first);
+        nfa = nfa + tmp;
+    }
+    return nfa;
+}
+
 inline bool NFA::match(const NFA::str_view_t& str) const noexcept
 {
-    fmt::print("TODO: {}", __func__);
-    assert(false);
+    if (_states.empty())
+        return false;
+    if (!_glushkov)
+        _glushkov = std::make_shared<const Glushkov>(_postfix);
+    return _glushkov->match(str);
 }
 
 inline std::optional<NFA::state_set_t> NFA::getReachedStates(const state_t state) const noexcept
 {
-    if (state < _state_count) {
+    if (state < _states.size()) {
         NFA::state_set_t reached_states {};
         getReachedStates(state, reached_states);
         return reached_states;
@@ -471,47 +615,119 @@ inline std::optional<NFA::state_set_t> NFA::getReachedStates(const state_t state
 inline std::optional<NFA::state_set_t>
     NFA::getReachedStates(const NFA::state_t state, char_t ch) const noexcept
 {
-    auto it = _state_transition_map.find({ state, ch });
-    if (it == _state_transition_map.end()) {
+    const auto& s = _states[state];
+    if (s.next == INVALID_STATE || s.ch != ch) {
         return std::nullopt;
     }
 
-    return getReachedStates(it->second);
+    return getReachedStates(s.next);
 }
 
 // 获取通过给定字符从当前状态集合转移到的状态集合
 inline void NFA::getReachedStates(
     const NFA::state_t state, char_t ch, NFA::state_set_t& reached_states) const noexcept
 {
-    auto it = _state_transition_map.find({ state, ch });
-    if (it == _state_transition_map.end()) {
+    const auto& s = _states[state];
+    if (s.next == INVALID_STATE || s.ch != ch) {
         return;
     }
 
-    getReachedStates(it->second, reached_states);
+    getReachedStates(s.next, reached_states);
 }
 
 // 将通过空字符从当前状态转移到的状态集合添加到 reached_states 中
 inline void
     NFA::getReachedStates(const NFA::state_t state, NFA::state_set_t& reached_states) const noexcept
 {
-    std::stack<state_t> st {};
-    st.emplace(state);
-    reached_states.emplace(state);
+    auto closure = getEpsilonClosure(state);
+    reached_states.insert(closure.begin(), closure.end());
+}
 
+/**
+ * @brief Tarjan's SCC over the epsilon edges, a component is finished after every component it
+ * reaches, so its closure is its members plus the already computed closures of its successors
+ */
+inline void NFA::_buildClosureCache() const noexcept
+{
+    const auto state_count = static_cast<state_t>(_states.size());
+    _closure_component.assign(state_count, INVALID_STATE);
+    _closure_offsets.assign(1, 0);
+    _closures.clear();
+
+    std::vector<state_t> index(state_count, INVALID_STATE), lowlink(state_count);
+    std::vector<uint32_t> stamp(state_count, 0);
+    uint32_t current_stamp = 0;
+    std::vector<state_t> scc_stack {};
+    // (state, next epsilon edge to visit)
+    std::vector<std::pair<state_t, uint8_t>> call_stack {};
+    state_t counter = 0, component_count = 0;
+
+    auto visit = [&](state_t state) {
+        index[state] = lowlink[state] = counter++;
+        scc_stack.push_back(state);
+        call_stack.emplace_back(state, 0);
+    };
 
-    while (!st.empty()) {
-        auto state = st.top();
-        st.pop();
-        if (_epsilon_transition_map.find(state) == _epsilon_transition_map.end())
+    auto add = [&](state_t state) {
+        if (stamp[state] == current_stamp)
+            return;
+        stamp[state] = current_stamp;
+        _closures.push_back(state);
+    };
+
+    for (state_t root = 0; root < state_count; ++root) {
+        if (index[root] != INVALID_STATE)
             continue;
 
-        for (const auto& s : _epsilon_transition_map.at(state)) {
-            if (reached_states.find(s) != reached_states.end())
+        visit(root);
+        while (!call_stack.empty()) {
+            auto [state, edge] = call_stack.back();
+            if (edge < 2) {
+                ++call_stack.back().second;
+                auto next = _states[state].epsilon[edge];
+                if (next == INVALID_STATE)
+                    continue;
+
+                if (index[next] == INVALID_STATE)
+                    visit(next);
+                else if (_closure_component[next] == INVALID_STATE)
+                    lowlink[state] = std::min(lowlink[state], index[next]);
                 continue;
+            }
 
-            st.emplace(s);
-            reached_states.emplace(s);
+            call_stack.pop_back();
+            if (!call_stack.empty()) {
+                auto parent = call_stack.back().first;
+                lowlink[parent] = std::min(lowlink[parent], lowlink[state]);
+            }
+            if (lowlink[state] != index[state])
+                continue;
+
+            // pop the component, then merge the closures of the components it reaches
+            const auto component = component_count++;
+            const auto begin = _closures.size();
+            ++current_stamp;
+            state_t member {};
+            do {
+                member = scc_stack.back();
+                scc_stack.pop_back();
+                _closure_component[member] = component;
+                add(member);
+            } while (member != state);
+
+            const auto members_end = _closures.size();
+            for (auto i = begin; i < members_end; ++i) {
+                for (auto next : _states[_closures[i]].epsilon) {
+                    if (next == INVALID_STATE || _closure_component[next] == component)
+                        continue;
+
+                    auto successor = _closure_component[next];
+                    for (auto j = _closure_offsets[successor]; j < _closure_offsets[successor + 1]; ++j)
+                        add(_closures[j]);
+                }
+            }
+            std::sort(_closures.begin() + begin, _closures.end());
+            _closure_offsets.push_back(_closures.size());
         }
     }
 }
@@ -0,0 +1,282 @@
+#pragma once
+#include <FSA.hpp>
+#include <NFA.hpp>
+#include <Token.hpp>
+#include <array>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
+
+/**
+ * @class SparseSet
+ * @brief Set of states below a fixed bound, O(1) insert, lookup and clear, no allocation after
+ * the construction
+ * the dense array keeps the insertion order, sparse maps a state to its index in dense
+ *
+ */
+class SparseSet {
+public:
+    using state_t = FSA::state_t;
+
+public:
+    explicit SparseSet(std::size_t bound):
+        _dense(bound),
+        _sparse(bound)
+    {
+    }
+
+    bool contains(state_t state) const noexcept
+    {
+        const auto index = _sparse[state];
+        return index < _size && _dense[index] == state;
+    }
+
+    /**
+     * @return false if the state is already in the set
+     */
+    bool insert(state_t state) noexcept
+    {
+        if (contains(state))
+            return false;
+        _sparse[state] = _size;
+        _dense[_size++] = state;
+        return true;
+    }
+
+    void clear() noexcept
+    {
+        _size = 0;
+    }
+
+    std::size_t size() const noexcept
+    {
+        return _size;
+    }
+
+    bool empty() const noexcept
+    {
+        return _size == 0;
+    }
+
+    const state_t* begin() const noexcept
+    {
+        return _dense.data();
+    }
+
+    const state_t* end() const noexcept
+    {
+        return _dense.data() + _size;
+    }
+
+private:
+    std::vector<state_t> _dense;
+    // stale entries are harmless, contains() checks them against dense
+    std::vector<state_t> _sparse;
+    std::size_t _size {};
+};
+
+/**
+ * @class PikeVM
+ * @brief Thompson NFA simulation in lockstep, O(n * m) time and O(m) memory whatever the NFA
+ * for one longestMatch, for the grammars whose DFA is too large to build
+ * NOTE : tokenize restarts the VM at every token and rereads the lookahead past it, so a
+ * tokenization is O(n² * m) in the worst case [e.g. rules "a" and "a*b" over "aaa...a"]
+ * the current states live in a sparse set, a step moves every state over the char and follows
+ * the epsilon transitions with an explicit stack, nothing is allocated while scanning
+ * it keeps scratch buffers, so every thread needs its own instance
+ *
+ */
+class PikeVM {
+public:
+    using state_t = FSA::state_t;
+    using kind_t = FSA::kind_t;
+    using state_info_t = FSA::state_info_t;
+    constexpr static std::size_t ALPHABET_SIZE = 256;
+
+    struct Match
+    {
+        kind_t kind { FSA::INVALID_KIND };
+        std::size_t length {};
+    };
+
+public:
+    /**
+     * @param nfa copied, the VM doesn't depend on it afterwards
+     */
+    explicit PikeVM(const NFA& nfa);
+
+public:
+    /**
+     * @brief Match the longest prefix of input accepted by a rule
+     * the rule of highest priority wins among the ones accepting the longest prefix [the first
+     * rule of the NFA on equal priority], like the DFA
+     * return INVALID_KIND if no non-empty prefix matches
+     */
+    Match longestMatch(std::string_view input);
+
+    /**
+     * @brief Tokenize input into the given list [cleared, capacity reused]
+     * one longestMatch per token, so the input read past a token to look for a longer match is
+     * read again by the next ones: quadratic in the worst case, linear when the lookahead past
+     * every token is bounded
+     *
+     * @return where lexing stopped, input.size() unless no token matches there
+     */
+    std::size_t tokenize(std::string_view input, TokenList& tokens);
+
+    /**
+     * @brief Get the token type name of the given kind
+     * kinds are numbered in name order over every rule of the NFA, which differs from the DFA as
+     * soon as a rule is shadowed: the DFA only numbers the names accepted by some state, so kinds
+     * of both are only comparable by name
+     */
+    const state_info_t& getTokenName(kind_t kind) const noexcept
+    {
+        return _token_names[kind];
+    }
+
+    const std::vector<state_info_t>& getTokenNames() const noexcept
+    {
+        return _token_names;
+    }
+
+private:
+    /**
+     * @brief Add the state and its epsilon closure to the set, track the best accepted rule
+     */
+    void _addState(state_t state, SparseSet& set);
+
+    std::span<const state_t> _getStartTargets(char ch) const noexcept
+    {
+        const auto byte = static_cast<unsigned char>(ch);
+        return { _start_targets.data() + _start_offsets[byte],
+                 _start_targets.data() + _start_offsets[byte + 1] };
+    }
+
+private:
+    std::shared_ptr<const NFA> _nfa {};
+
+    // INFO : per NFA state, the rule accepted there [INVALID_KIND if none] and its priority
+    std::vector<kind_t> _accept_kind {};
+    std::vector<NFA::priority_t> _priority {};
+    std::vector<state_info_t> _token_names {};
+
+    // INFO : every token starts from the same closure, so its moves are computed once,
+    // the targets of each byte in CSR layout
+    std::array<std::size_t, ALPHABET_SIZE + 1> _start_offsets {};
+    std::vector<state_t> _start_targets {};
+
+    // INFO : scratch buffers
+    SparseSet _current;
+    SparseSet _next;
+    std::vector<state_t> _stack {};
+    // the best rule accepted by the states added in the current step
+    state_t _best_state { FSA::INVALID_STATE };
+};
+
+inline PikeVM::PikeVM(const NFA& nfa):
+    _nfa { std::make_shared<const NFA>(nfa) },
+    _current { nfa.getStateCount() },
+    _next { nfa.getStateCount() }
+{
+    const auto state_count = nfa.getStateCount();
+    _accept_kind.assign(state_count, FSA::INVALID_KIND);
+    _priority.assign(state_count, -1);
+    // a state is pushed once per incoming epsilon before it is checked, and has at most two
+    _stack.reserve(2 * state_count + 1);
+
+    FSA::map_t<state_info_t, kind_t> kinds {};
+    for (const auto& [state, info] : nfa.getStateInfoMap())
+        kinds.emplace(info.second, 0);
+    for (auto& [name, kind] : kinds) {
+        kind = _token_names.size();
+        _token_names.push_back(name);
+    }
+
+    for (const auto& [state, info] : nfa.getStateInfoMap()) {
+        _accept_kind[state] = kinds.at(info.second);
+        _priority[state] = info.first;
+    }
+
+    if (state_count == 0)
+        return;
+    std::array<std::vector<state_t>, ALPHABET_SIZE> targets {};
+    _addState(nfa.getStartState(), _current);
+    for (auto state : _current) {
+        const auto& s = nfa.getState(state);
+        if (s.next != FSA::INVALID_STATE)
+            targets[static_cast<unsigned char>(s.ch)].push_back(s.next);
+    }
+    for (std::size_t byte = 0; byte < ALPHABET_SIZE; ++byte) {
+        _start_offsets[byte] = _start_targets.size();
+        _start_targets.insert(_start_targets.end(), targets[byte].begin(), targets[byte].end());
+    }
+    _start_offsets[ALPHABET_SIZE] = _start_targets.size();
+}
+
+inline void PikeVM::_addState(state_t state, SparseSet& set)
+{
+    _stack.push_back(state);
+    while (!_stack.empty()) {
+        const auto top = _stack.back();
+        _stack.pop_back();
+        if (!set.insert(top))
+            continue;
+
+        // the lower state wins on equal priority, as in the subset construction
+        if (_accept_kind[top] != FSA::INVALID_KIND) {
+            if (_best_state == FSA::INVALID_STATE || _priority[top] > _priority[_best_state]
+                || (_priority[top] == _priority[_best_state] && top < _best_state))
+                _best_state = top;
+        }
+
+        const auto& s = _nfa->getState(top);
+        for (auto epsilon : s.epsilon) {
+            if (epsilon != FSA::INVALID_STATE)
+                _stack.push_back(epsilon);
+        }
+    }
+}
+
+inline PikeVM::Match PikeVM::longestMatch(std::string_view input)
+{
+    Match match {};
+    for (std::size_t pos = 0; pos < input.size(); ++pos) {
+        const auto ch = input[pos];
+        _next.clear();
+        _best_state = FSA::INVALID_STATE;
+        if (pos == 0) {
+            for (auto target : _getStartTargets(ch))
+                _addState(target, _next);
+        }
+        else {
+            for (auto state : _current) {
+                const auto& s = _nfa->getState(state);
+                if (s.next != FSA::INVALID_STATE && s.ch == ch)
+                    _addState(s.next, _next);
+            }
+        }
+        if (_next.empty())
+            break;
+
+        std::swap(_current, _next);
+        if (_best_state != FSA::INVALID_STATE)
+            match = { _accept_kind[_best_state], pos + 1 };
+    }
+    return match;
+}
+
+inline std::size_t PikeVM::tokenize(std::string_view input, TokenList& tokens)
+{
+    tokens.clear();
+    std::size_t pos = 0;
+    while (pos < input.size()) {
+        const auto [kind, length] = longestMatch(input.substr(pos));
+        if (kind == FSA::INVALID_KIND)
+            break;
+        tokens.push(kind, pos, length);
+        pos += length;
+    }
+    return pos;
+}
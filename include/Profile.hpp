@@ -0,0 +1,294 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Per-phase timing, allocation counts and counters of a generator run
+ * compiled in with LEXER_PROFILE [xmake f --profile=y], every macro is empty otherwise
+ *
+ * PROFILE_SCOPE(name)          time the rest of the scope as the phase name [inclusive of nested phases]
+ * PROFILE_COUNT(name, value)   add value to the counter name [value isn't evaluated when disabled]
+ * Profile::Counter             a counter kept locally and flushed to the report at once, for hot paths
+ * PROFILE_ALLOCATION_HOOK()    replace the global operator new/delete to count allocations,
+ *                              once at namespace scope of one translation unit of the program
+ */
+#if defined(LEXER_PROFILE)
+    #include <atomic>
+    #include <chrono>
+    #include <cstdlib>
+    #include <fmt/format.h>
+    #include <fstream>
+    #include <map>
+    #include <mutex>
+    #include <new>
+    #include <string_view>
+
+namespace Profile {
+struct phase_t
+{
+    std::size_t calls {};
+    std::chrono::nanoseconds time {};
+    std::size_t allocations {};
+    std::size_t allocated_bytes {};
+};
+
+// INFO : bumped by the allocation hook, from every thread
+inline std::atomic<std::size_t> allocation_count {};
+inline std::atomic<std::size_t> allocated_bytes {};
+
+/**
+ * @brief malloc/free behind the allocation hook, with the count on the way in
+ * NOTE : kept out of line, GCC warns [-Wmismatched-new-delete] once free is inlined into a caller
+ * which got the pointer from operator new
+ */
+[[gnu::noinline]] inline void* allocate(std::size_t size) noexcept
+{
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+
+[[gnu::noinline]] inline void deallocate(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+/**
+ * @class Profiler
+ * @brief The process wide report, safe to update from several threads
+ *
+ */
+class Profiler {
+public:
+    static Profiler& get() noexcept
+    {
+        static Profiler profiler {};
+        return profiler;
+    }
+
+    void addPhase(std::string_view name, const phase_t& phase)
+    {
+        std::lock_guard lock { _mutex };
+        auto& total = _find(_phases, name);
+        total.calls += phase.calls;
+        total.time += phase.time;
+        total.allocations += phase.allocations;
+        total.allocated_bytes += phase.allocated_bytes;
+    }
+
+    void count(std::string_view name, std::size_t value)
+    {
+        std::lock_guard lock { _mutex };
+        _find(_counters, name) += value;
+    }
+
+    void clear()
+    {
+        std::lock_guard lock { _mutex };
+        _phases.clear();
+        _counters.clear();
+    }
+
+    std::map<std::string, phase_t, std::less<>> getPhases() const
+    {
+        std::lock_guard lock { _mutex };
+        return _phases;
+    }
+
+    std::map<std::string, std::size_t, std::less<>> getCounters() const
+    {
+        std::lock_guard lock { _mutex };
+        return _counters;
+    }
+
+    std::string toJson() const;
+
+private:
+    template <typename Map>
+    static typename Map::mapped_type& _find(Map& map, std::string_view name)
+    {
+        auto it = map.find(name);
+        if (it == map.end())
+            it = map.emplace(std::string { name }, typename Map::mapped_type {}).first;
+        return it->second;
+    }
+
+private:
+    mutable std::mutex _mutex {};
+    std::map<std::string, phase_t, std::less<>> _phases {};
+    std::map<std::string, std::size_t, std::less<>> _counters {};
+};
+
+/**
+ * @brief {"phases": {name: {calls, seconds, allocations, allocated_bytes}}, "counters": {name: value}}
+ * the names are plain identifiers, so they need no escaping
+ */
+inline std::string Profiler::toJson() const
+{
+    std::lock_guard lock { _mutex };
+    std::string json { "{\n  \"phases\": {" };
+    auto separator = "\n";
+    for (const auto& [name, phase] : _phases) {
+        json += fmt::format(
+            "{}    \"{}\": {{ \"calls\": {}, \"seconds\": {:.9f}, \"allocations\": {}, "
+            "\"allocated_bytes\": {} }}",
+            separator,
+            name,
+            phase.calls,
+            std::chrono::duration<double>(phase.time).count(),
+            phase.allocations,
+            phase.allocated_bytes);
+        separator = ",\n";
+    }
+    json += "\n  },\n  \"counters\": {";
+    separator = "\n";
+    for (const auto& [name, value] : _counters) {
+        json += fmt::format("{}    \"{}\": {}", separator, name, value);
+        separator = ",\n";
+    }
+    json += "\n  }\n}\n";
+    return json;
+}
+
+/**
+ * @class ScopedPhase
+ * @brief Adds the time and allocations between construction and destruction to a phase
+ *
+ */
+class ScopedPhase {
+public:
+    explicit ScopedPhase(std::string_view name) noexcept:
+        _name { name },
+        _allocations { allocation_count.load(std::memory_order_relaxed) },
+        _allocated_bytes { allocated_bytes.load(std::memory_order_relaxed) },
+        _start { std::chrono::steady_clock::now() }
+    {
+    }
+
+    ScopedPhase(const ScopedPhase&) = delete;
+    ScopedPhase& operator= (const ScopedPhase&) = delete;
+
+    ~ScopedPhase()
+    {
+        const auto end = std::chrono::steady_clock::now();
+        Profiler::get().addPhase(
+            _name,
+            { .calls = 1,
+              .time = end - _start,
+              .allocations = allocation_count.load(std::memory_order_relaxed) - _allocations,
+              .allocated_bytes = allocated_bytes.load(std::memory_order_relaxed) - _allocated_bytes });
+    }
+
+private:
+    std::string_view _name;
+    std::size_t _allocations;
+    std::size_t _allocated_bytes;
+    std::chrono::steady_clock::time_point _start;
+};
+
+/**
+ * @class Counter
+ * @brief Sums its values locally, PROFILE_COUNT takes the report lock on every call
+ * the sum is added to the report on flush and destruction, a copy starts from zero
+ *
+ */
+class Counter {
+public:
+    explicit Counter(std::string_view name) noexcept:
+        _name { name }
+    {
+    }
+
+    Counter(const Counter& other) noexcept:
+        _name { other._name }
+    {
+    }
+
+    Counter& operator= (const Counter&) = delete;
+
+    ~Counter()
+    {
+        flush();
+    }
+
+    void add(std::size_t value) noexcept
+    {
+        _value += value;
+    }
+
+    void flush()
+    {
+        if (_value == 0)
+            return;
+        Profiler::get().count(_name, _value);
+        _value = 0;
+    }
+
+private:
+    std::string_view _name;
+    std::size_t _value {};
+};
+} // namespace Profile
+
+    #define PROFILE_CONCAT_IMPL(a, b) a##b
+    #define PROFILE_CONCAT(a, b)      PROFILE_CONCAT_IMPL(a, b)
+    #define PROFILE_SCOPE(name) \
+        const Profile::ScopedPhase PROFILE_CONCAT(_profile_phase_, __LINE__) \
+        { \
+            name \
+        }
+    #define PROFILE_COUNT(name, value) Profile::Profiler::get().count(name, value)
+
+    // NOTE : the aligned overloads keep their default definitions, they aren't counted
+    #define PROFILE_ALLOCATION_HOOK() \
+        void* operator new (std::size_t size) \
+        { \
+            if (auto* ptr = Profile::allocate(size)) \
+                return ptr; \
+            throw std::bad_alloc {}; \
+        } \
+        void operator delete (void* ptr) noexcept \
+        { \
+            Profile::deallocate(ptr); \
+        } \
+        void operator delete (void* ptr, std::size_t) noexcept \
+        { \
+            Profile::deallocate(ptr); \
+        }
+
+#else
+    #define PROFILE_SCOPE(name)        ((void)0)
+    #define PROFILE_COUNT(name, value) ((void)0)
+    #define PROFILE_ALLOCATION_HOOK()
+
+namespace Profile {
+class Counter {
+public:
+    explicit constexpr Counter(std::string_view) noexcept { }
+
+    constexpr void add(std::size_t) noexcept { }
+
+    constexpr void flush() noexcept { }
+};
+} // namespace Profile
+#endif
+
+namespace Profile {
+/**
+ * @brief Write the JSON report to filename
+ * return false if the profiling isn't compiled in
+ */
+inline bool saveReport([[maybe_unused]] const std::string& filename)
+{
+#if defined(LEXER_PROFILE)
+    std::ofstream fout { filename, std::ios_base::out | std::ios_base::binary };
+    if (!fout.is_open())
+        return false;
+    fout << Profiler::get().toJson();
+    return true;
+#else
+    return false;
+#endif
+}
+} // namespace Profile
@@ -0,0 +1,152 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+#if defined(__SSE2__)
+    #include <immintrin.h>
+#endif
+
+/**
+ * @brief Vectorized byte scanning, SSE2/AVX2 when the target has them, scalar otherwise
+ */
+namespace Simd {
+struct ByteRange
+{
+    uint8_t lo;
+    uint8_t hi;
+};
+
+/**
+ * @class RangeSet
+ * @brief A byte set stored as a few inclusive ranges [or the complement of them]
+ * a range is checked with one subtract and one unsigned compare per vector
+ *
+ */
+class RangeSet {
+public:
+    constexpr static std::size_t MAX_RANGES = 6;
+    constexpr static std::size_t ALPHABET_SIZE = 256;
+
+public:
+    /**
+     * @brief Build the set from a membership table indexed by byte
+     * the set or its complement, whichever has fewer ranges, is kept
+     * return nullopt if both need more than MAX_RANGES ranges
+     */
+    static std::optional<RangeSet> fromTable(const std::array<bool, ALPHABET_SIZE>& table) noexcept;
+
+    bool contains(char ch) const noexcept
+    {
+        const auto byte = static_cast<uint8_t>(ch);
+        bool in = false;
+        for (std::size_t i = 0; i < _count; ++i)
+            in |= static_cast<uint8_t>(byte - _ranges[i].lo) <= _ranges[i].hi - _ranges[i].lo;
+        return in != _negated;
+    }
+
+    /**
+     * @brief Get the length of the longest prefix of data inside the set
+     */
+    std::size_t countPrefix(std::string_view data) const noexcept;
+
+private:
+#if defined(__AVX2__)
+    uint32_t _match32(const char* data) const noexcept;
+#endif
+#if defined(__SSE2__)
+    uint32_t _match16(const char* data) const noexcept;
+#endif
+
+private:
+    std::array<ByteRange, MAX_RANGES> _ranges {};
+    uint8_t _count {};
+    bool _negated {};
+};
+
+inline std::optional<RangeSet>
+    RangeSet::fromTable(const std::array<bool, ALPHABET_SIZE>& table) noexcept
+{
+    auto build = [&table](bool negated) -> std::optional<RangeSet> {
+        RangeSet set {};
+        set._negated = negated;
+        for (std::size_t byte = 0; byte < ALPHABET_SIZE;) {
+            if (table[byte] == negated) {
+                ++byte;
+                continue;
+            }
+
+            auto end = byte;
+            while (end + 1 < ALPHABET_SIZE && table[end + 1] != negated)
+                ++end;
+            if (set._count == MAX_RANGES)
+                return std::nullopt;
+            set._ranges[set._count++] = { static_cast<uint8_t>(byte), static_cast<uint8_t>(end) };
+            byte = end + 1;
+        }
+        return set;
+    };
+
+    auto set = build(false);
+    auto complement = build(true);
+    if (set && complement)
+        return set->_count <= complement->_count ? set : complement;
+    return set ? set : complement;
+}
+
+#if defined(__AVX2__)
+// bit i is set if data[i] is in the set
+inline uint32_t RangeSet::_match32(const char* data) const noexcept
+{
+    const auto bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+    auto in = _mm256_setzero_si256();
+    for (std::size_t i = 0; i < _count; ++i) {
+        const auto offset = _mm256_sub_epi8(bytes, _mm256_set1_epi8(static_cast<char>(_ranges[i].lo)));
+        const auto width = _mm256_set1_epi8(static_cast<char>(_ranges[i].hi - _ranges[i].lo));
+        in = _mm256_or_si256(in, _mm256_cmpeq_epi8(_mm256_min_epu8(offset, width), offset));
+    }
+    const auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(in));
+    return _negated ? ~mask : mask;
+}
+#endif
+
+#if defined(__SSE2__)
+// bit i is set if data[i] is in the set [the upper 16 bits are clear]
+inline uint32_t RangeSet::_match16(const char* data) const noexcept
+{
+    const auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    auto in = _mm_setzero_si128();
+    for (std::size_t i = 0; i < _count; ++i) {
+        const auto offset = _mm_sub_epi8(bytes, _mm_set1_epi8(static_cast<char>(_ranges[i].lo)));
+        const auto width = _mm_set1_epi8(static_cast<char>(_ranges[i].hi - _ranges[i].lo));
+        in = _mm_or_si128(in, _mm_cmpeq_epi8(_mm_min_epu8(offset, width), offset));
+    }
+    const auto mask = static_cast<uint32_t>(_mm_movemask_epi8(in));
+    return _negated ? ~mask & 0xffff : mask;
+}
+#endif
+
+inline std::size_t RangeSet::countPrefix(std::string_view data) const noexcept
+{
+    std::size_t count = 0;
+#if defined(__AVX2__)
+    for (; count + 32 <= data.size(); count += 32) {
+        const auto mask = _match32(data.data() + count);
+        if (mask != 0xffffffff)
+            return count + __builtin_ctz(~mask);
+    }
+#endif
+#if defined(__SSE2__)
+    for (; count + 16 <= data.size(); count += 16) {
+        const auto mask = _match16(data.data() + count);
+        if (mask != 0xffff)
+            return count + __builtin_ctz(~mask);
+    }
+#endif
+    while (count < data.size() && contains(data[count]))
+        ++count;
+    return count;
+}
+} // namespace Simd
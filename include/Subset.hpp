@@ -0,0 +1,343 @@
+#pragma once
+#include <FSA.hpp>
+#include <NFA.hpp>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <utility>
+#include <vector>
+
+/**
+ * @class StateSetTable
+ * @brief Interns sorted NFA state sets, every distinct set gets a dense id in insertion order
+ * the sets are stored back to back in one pool and looked up through an open addressing table
+ *
+ */
+class StateSetTable {
+public:
+    using state_t = FSA::state_t;
+    using set_view_t = std::span<const state_t>;
+
+public:
+    /**
+     * @brief Get the id of the set, insert it if it's new
+     *
+     * @param set sorted NFA states
+     * @return the id and whether the set was inserted
+     */
+    std::pair<state_t, bool> intern(set_view_t set)
+    {
+        return intern(set, hash(set));
+    }
+
+    /**
+     * @brief intern with the precomputed hash of the set
+     */
+    std::pair<state_t, bool> intern(set_view_t set, std::size_t hash);
+
+    set_view_t get(state_t id) const noexcept
+    {
+        return { _pool.data() + _offsets[id], _pool.data() + _offsets[id + 1] };
+    }
+
+    std::size_t size() const noexcept
+    {
+        return _hashes.size();
+    }
+
+    /**
+     * @brief Bytes used by the interned sets, clear() keeps the capacity for reuse
+     */
+    std::size_t getMemoryUsage() const noexcept
+    {
+        return _pool.size() * sizeof(state_t) + _offsets.size() * sizeof(std::size_t)
+             + _hashes.size() * sizeof(std::size_t) + _slots.size() * sizeof(state_t);
+    }
+
+    void clear() noexcept
+    {
+        _pool.clear();
+        _offsets.assign(1, 0);
+        _hashes.clear();
+        _slots.clear();
+    }
+
+    static std::size_t hash(set_view_t set) noexcept;
+
+private:
+    void _grow();
+
+private:
+    std::vector<state_t> _pool {};
+    std::vector<std::size_t> _offsets { 0 };
+    std::vector<std::size_t> _hashes {};
+    // ids, INVALID_STATE for empty slots, the size is a power of two
+    std::vector<state_t> _slots {};
+};
+
+inline std::size_t StateSetTable::hash(set_view_t set) noexcept
+{
+    std::size_t hash = 0xcbf29ce484222325ull;
+    for (auto state : set) {
+        hash ^= state;
+        hash *= 0x100000001b3ull;
+        hash ^= hash >> 29;
+    }
+    return hash;
+}
+
+inline void StateSetTable::_grow()
+{
+    _slots.assign(std::max<std::size_t>(_slots.size() * 2, 64), FSA::INVALID_STATE);
+    const auto mask = _slots.size() - 1;
+    for (state_t id = 0; id < _hashes.size(); ++id) {
+        auto slot = _hashes[id] & mask;
+        while (_slots[slot] != FSA::INVALID_STATE)
+            slot = (slot + 1) & mask;
+        _slots[slot] = id;
+    }
+}
+
+inline std::pair<StateSetTable::state_t, bool>
+    StateSetTable::intern(set_view_t set, std::size_t hash)
+{
+    // keep the load factor under 1/2
+    if ((_hashes.size() + 1) * 2 > _slots.size())
+        _grow();
+
+    const auto mask = _slots.size() - 1;
+    auto slot = hash & mask;
+    for (; _slots[slot] != FSA::INVALID_STATE; slot = (slot + 1) & mask) {
+        auto id = _slots[slot];
+        if (_hashes[id] == hash && std::ranges::equal(get(id), set))
+            return { id, false };
+    }
+
+    auto id = static_cast<state_t>(_hashes.size());
+    _slots[slot] = id;
+    _hashes.push_back(hash);
+    _pool.insert(_pool.end(), set.begin(), set.end());
+    _offsets.push_back(_pool.size());
+    return { id, true };
+}
+
+/**
+ * @class ConcurrentStateSetTable
+ * @brief StateSetTable split into shards by hash, every shard behind its own mutex
+ * the ids are provisional [local id * SHARD_COUNT + shard], so they depend on the thread timing
+ *
+ */
+class ConcurrentStateSetTable {
+public:
+    using state_t = FSA::state_t;
+    using set_view_t = std::span<const state_t>;
+    constexpr static std::size_t SHARD_COUNT = 64;
+
+public:
+    std::pair<state_t, bool> intern(set_view_t set)
+    {
+        const auto hash = StateSetTable::hash(set);
+        // the shard takes the high bits, the table of the shard the low ones
+        const auto shard = (hash >> 32) % SHARD_COUNT;
+        std::lock_guard lock { _shards[shard].mutex };
+        auto [id, inserted] = _shards[shard].sets.intern(set, hash);
+        return { static_cast<state_t>(id * SHARD_COUNT + shard), inserted };
+    }
+
+    /**
+     * @brief Copy the set out, the pool of the shard may be reallocated by another thread
+     */
+    void get(state_t id, std::vector<state_t>& set) const
+    {
+        const auto& shard = _shards[id % SHARD_COUNT];
+        std::lock_guard lock { shard.mutex };
+        auto view = shard.sets.get(id / SHARD_COUNT);
+        set.assign(view.begin(), view.end());
+    }
+
+    /**
+     * @brief One past the largest provisional id
+     */
+    std::size_t getIdBound() const
+    {
+        std::size_t bound = 0;
+        for (std::size_t shard = 0; shard < SHARD_COUNT; ++shard) {
+            std::lock_guard lock { _shards[shard].mutex };
+            bound = std::max(bound, _shards[shard].sets.size() * SHARD_COUNT + shard);
+        }
+        return bound;
+    }
+
+private:
+    struct alignas(64) Shard
+    {
+        mutable std::mutex mutex;
+        StateSetTable sets;
+    };
+
+    std::array<Shard, SHARD_COUNT> _shards {};
+};
+
+/**
+ * @class SubsetConstruction
+ * @brief The NFA side of the subset construction: moves and accept info of NFA state sets,
+ * on top of the epsilon closure cache of the NFA
+ * it keeps scratch buffers, so every thread needs its own instance
+ *
+ */
+class SubsetConstruction {
+public:
+    using state_t = FSA::state_t;
+    using char_t = FSA::char_t;
+    using state_info_t = FSA::state_info_t;
+    using set_view_t = std::span<const state_t>;
+    using set_t = std::vector<state_t>;
+    constexpr static std::size_t ALPHABET_SIZE = 256;
+
+public:
+    explicit SubsetConstruction(const NFA& nfa);
+
+public:
+    /**
+     * @brief Get the epsilon closure of the start state
+     */
+    void getStartSet(set_t& set) const;
+
+    /**
+     * @brief Call on_move(ch, const set_t& next_set) for every char leading out of the set,
+     * in char order, next_set is the sorted epsilon closure of the moved states
+     * the set is only read before the first callback, so it may point into a table the
+     * callback grows
+     */
+    template <typename Callback>
+    void forEachMove(set_view_t set, Callback&& on_move);
+
+    /**
+     * @brief Get the sorted epsilon closure of the states reached from the set by ch
+     */
+    void move(set_view_t set, char_t ch, set_t& next_set);
+
+    bool isFinal(set_view_t set) const noexcept
+    {
+        return std::ranges::binary_search(set, _nfa->getFinalState());
+    }
+
+    /**
+     * @brief Get the info of the highest priority NFA final state in the set
+     * return nullptr if there is none
+     */
+    const state_info_t* getStateInfo(set_view_t set) const noexcept;
+
+private:
+    void _unionClosures(set_view_t targets, set_t& set);
+
+private:
+    const NFA* _nfa;
+
+    // INFO : index into _infos for every NFA state [-1 if the state has no info]
+    std::vector<int32_t> _info_index {};
+    std::vector<std::pair<NFA::priority_t, state_info_t>> _infos {};
+
+    // INFO : scratch buffers
+    std::vector<uint32_t> _stamp {};
+    uint32_t _current_stamp {};
+    std::array<set_t, ALPHABET_SIZE> _targets {};
+};
+
+inline SubsetConstruction::SubsetConstruction(const NFA& nfa):
+    _nfa { &nfa }
+{
+    const auto state_count = nfa.getStateCount();
+    nfa.buildClosureCache();
+    _stamp.assign(state_count, 0);
+
+    _info_index.assign(state_count, -1);
+    for (const auto& [state, info] : nfa.getStateInfoMap()) {
+        _info_index[state] = _infos.size();
+        _infos.push_back(info);
+    }
+}
+
+inline void SubsetConstruction::getStartSet(set_t& set) const
+{
+    auto closure = _nfa->getEpsilonClosure(_nfa->getStartState());
+    set.assign(closure.begin(), closure.end());
+}
+
+inline void SubsetConstruction::_unionClosures(set_view_t targets, set_t& set)
+{
+    // a single target is already a sorted closure
+    if (targets.size() == 1) {
+        auto closure = _nfa->getEpsilonClosure(targets.front());
+        set.assign(closure.begin(), closure.end());
+        return;
+    }
+
+    set.clear();
+    ++_current_stamp;
+    for (auto target : targets) {
+        for (auto state : _nfa->getEpsilonClosure(target)) {
+            if (_stamp[state] == _current_stamp)
+                continue;
+            _stamp[state] = _current_stamp;
+            set.push_back(state);
+        }
+    }
+    std::sort(set.begin(), set.end());
+}
+
+template <typename Callback>
+inline void SubsetConstruction::forEachMove(set_view_t set, Callback&& on_move)
+{
+    // bucket the char transitions by char
+    for (auto state : set) {
+        const auto& s = _nfa->getState(state);
+        if (s.next != FSA::INVALID_STATE)
+            _targets[static_cast<unsigned char>(s.ch)].push_back(s.next);
+    }
+
+    // the same order as the charset [signed char]
+    set_t next_set {};
+    for (int ch = -128; ch < 128; ++ch) {
+        auto& targets = _targets[static_cast<unsigned char>(ch)];
+        if (targets.empty())
+            continue;
+
+        _unionClosures(targets, next_set);
+        targets.clear();
+        on_move(static_cast<char_t>(ch), static_cast<const set_t&>(next_set));
+    }
+}
+
+inline void SubsetConstruction::move(set_view_t set, char_t ch, set_t& next_set)
+{
+    auto& targets = _targets[static_cast<unsigned char>(ch)];
+    for (auto state : set) {
+        const auto& s = _nfa->getState(state);
+        if (s.next != FSA::INVALID_STATE && s.ch == ch)
+            targets.push_back(s.next);
+    }
+    _unionClosures(targets, next_set);
+    targets.clear();
+}
+
+inline const SubsetConstruction::state_info_t*
+    SubsetConstruction::getStateInfo(set_view_t set) const noexcept
+{
+    const state_info_t* info = nullptr;
+    NFA::priority_t priority = -1;
+    for (auto state : set) {
+        auto index = _info_index[state];
+        if (index == -1)
+            continue;
+
+        // the first one wins on equal priority
+        if (_infos[index].first > priority) {
+            priority = _infos[index].first;
+            info = &_infos[index].second;
+        }
+    }
+    return info;
+}
@@ -0,0 +1,332 @@
+#pragma once
+#include <FSA.hpp>
+#include <NFA.hpp>
+#include <cassert>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Synthetic grammars and inputs for scaling benchmarks
+ * a grammar has the shape of the rules in src/main.cpp [regex -> (priority, type)],
+ * an input is a random sequence of tokens sampled from the rules, optionally mixed with noise
+ * no token matches
+ */
+namespace Synthetic {
+using rules_t = NFA::rules_t;
+
+constexpr auto LETTER = "(a|b|c|d|e|f|g|h|i|j|k|l|m|n|o|p|q|r|s|t|u|v|w|x|y|z|_)";
+constexpr auto DIGIT = "(0|1|2|3|4|5|6|7|8|9)";
+// bytes no rule uses
+constexpr std::string_view NOISE = "#$@`~!%&";
+
+/**
+ * @brief The base rules [ID, NUMBER, WS, SEMI, OP, PUNCT] are always there, the other rules
+ * come on top of them with priority 2
+ */
+struct grammar_config_t
+{
+    // literal keywords, KW_<keyword>
+    std::size_t keyword_count {};
+    // nested alternations of uppercase literals, ALT_<n>
+    std::size_t alternation_count {};
+    // a prefix followed by a counted repetition [x{m,n} spelled out], REP_<n>
+    std::size_t repetition_count {};
+    // nesting depth of the alternations
+    std::size_t max_depth { 3 };
+    uint32_t seed { 1 };
+};
+
+struct corpus_config_t
+{
+    // the input is at least size bytes
+    std::size_t size {};
+    // chance of a noise run [chars of NOISE] before every token
+    double noise_ratio {};
+    uint32_t seed { 2 };
+};
+
+constexpr std::size_t BASE_RULE_COUNT = 6;
+
+inline std::vector<std::string> makeKeywords(std::size_t keyword_count, uint32_t seed = 1)
+{
+    std::mt19937 rng { seed };
+    std::vector<std::string> keywords {};
+    FSA::set_t<std::string> seen {};
+    while (keywords.size() < keyword_count) {
+        std::string keyword {};
+        for (auto length = 2 + rng() % 7; keyword.size() < length;)
+            keyword += static_cast<char>('a' + rng() % 26);
+        if (seen.insert(keyword).second)
+            keywords.push_back(keyword);
+    }
+    return keywords;
+}
+
+inline rules_t makeGrammar(const grammar_config_t& config)
+{
+    rules_t rules {
+        {FSA::str_t { LETTER } + "(" + LETTER + "|" + DIGIT + ")*", { 1, "ID" }   },
+        { FSA::str_t { DIGIT } + "+",                               { 1, "NUMBER" }},
+        { "( |\n)+",                                                { 0, "WS" }    },
+        { ";",                                                      { 1, "SEMI" }  },
+        { "=|==|<|<=|>|>=",                                         { 1, "OP" }    },
+        { "{|}|,|.",                                                { 1, "PUNCT" } },
+    };
+    for (auto& keyword : makeKeywords(config.keyword_count, config.seed))
+        rules.emplace(keyword, std::make_pair(2, "KW_" + keyword));
+
+    std::mt19937 rng { config.seed };
+    auto literal = [&rng](std::size_t max_length) {
+        std::string str {};
+        for (auto length = 1 + rng() % max_length; str.size() < length;)
+            str += static_cast<char>('A' + rng() % 26);
+        return str;
+    };
+
+    // e.g. (AB|C(D|EF))
+    auto alternation = [&rng, &literal](auto&& self, std::size_t depth) -> std::string {
+        if (depth == 0)
+            return literal(2);
+        std::string str { "(" };
+        for (auto branch = 2 + rng() % 2; branch--;) {
+            str += rng() % 2 ? literal(2) + self(self, depth - 1) : self(self, depth - 1);
+            str += branch ? "|" : ")";
+        }
+        return str;
+    };
+
+    // the same regex can come out twice, so insert until the count is reached
+    for (std::size_t n = 0; rules.size() < BASE_RULE_COUNT + config.keyword_count
+                                               + config.alternation_count;) {
+        auto regex = literal(2) + alternation(alternation, 1 + rng() % config.max_depth);
+        if (rules.contains(regex))
+            continue;
+        rules.emplace(regex, std::make_pair(2, "ALT_" + std::to_string(n++)));
+    }
+
+    // x{m,n} -> x..x(x(x)?)?
+    auto repetition = [&rng, &literal]() {
+        const auto atom = rng() % 3 == 0 ? std::string { DIGIT } : "(" + literal(1) + ")";
+        const auto min = 1 + rng() % 3, max = min + rng() % 4;
+        std::string str {};
+        for (auto i = min; i--;)
+            str += atom;
+        for (auto i = min; i < max; ++i)
+            str += "(" + atom;
+        for (auto i = min; i < max; ++i)
+            str += ")?";
+        return str;
+    };
+
+    for (std::size_t n = 0; rules.size() < BASE_RULE_COUNT + config.keyword_count
+                                               + config.alternation_count + config.repetition_count;) {
+        auto regex = literal(2) + repetition();
+        if (rules.contains(regex))
+            continue;
+        rules.emplace(regex, std::make_pair(2, "REP_" + std::to_string(n++)));
+    }
+    return rules;
+}
+
+/**
+ * @brief A grammar of rule_count rules: the base rules, then 80% keywords, 10% alternations and
+ * 10% repetitions
+ */
+inline rules_t makeGrammar(std::size_t rule_count, uint32_t seed = 1)
+{
+    const auto extra = rule_count > BASE_RULE_COUNT ? rule_count - BASE_RULE_COUNT : 0;
+    grammar_config_t config {};
+    config.alternation_count = extra / 10;
+    config.repetition_count = extra / 10;
+    config.keyword_count = extra - config.alternation_count - config.repetition_count;
+    config.seed = seed;
+    return makeGrammar(config);
+}
+
+
+/**
+ * @class Sampler
+ * @brief Random strings matching a regex [the rule syntax, before addConcatOperator]
+ *
+ */
+class Sampler {
+public:
+    explicit Sampler(std::string_view regex);
+
+    template <typename Rng>
+    void sample(Rng& rng, std::string& out) const
+    {
+        _sample(_root, rng, out);
+    }
+
+private:
+    enum class NodeType {
+        Char,
+        Concat,
+        Alternation,
+        Star,
+        Plus,
+        Optional,
+    };
+
+    struct Node
+    {
+        NodeType type;
+        char ch {};
+        std::vector<std::size_t> children {};
+    };
+
+    // alternation := concat ('|' concat)*
+    std::size_t _parseAlternation();
+    // concat := postfix*
+    std::size_t _parseConcat();
+    // postfix := atom ('*' | '+' | '?')*, atom := '(' alternation ')' | char
+    std::size_t _parsePostfix();
+
+    std::size_t _newNode(NodeType type, char ch = 0)
+    {
+        _nodes.push_back({ type, ch });
+        return _nodes.size() - 1;
+    }
+
+    template <typename Rng>
+    void _sample(std::size_t index, Rng& rng, std::string& out) const;
+
+private:
+    std::string_view _regex;
+    std::size_t _pos {};
+    std::vector<Node> _nodes {};
+    std::size_t _root {};
+};
+
+inline Sampler::Sampler(std::string_view regex):
+    _regex { regex }
+{
+    _root = _parseAlternation();
+    assert(_pos == _regex.size());
+}
+
+inline std::size_t Sampler::_parseAlternation()
+{
+    auto node = _newNode(NodeType::Alternation);
+    auto first = _parseConcat();
+    _nodes[node].children.push_back(first);
+    while (_pos < _regex.size() && _regex[_pos] == '|') {
+        ++_pos;
+        auto child = _parseConcat();
+        _nodes[node].children.push_back(child);
+    }
+    return node;
+}
+
+inline std::size_t Sampler::_parseConcat()
+{
+    auto node = _newNode(NodeType::Concat);
+    while (_pos < _regex.size() && _regex[_pos] != '|' && _regex[_pos] != ')') {
+        auto child = _parsePostfix();
+        _nodes[node].children.push_back(child);
+    }
+    return node;
+}
+
+inline std::size_t Sampler::_parsePostfix()
+{
+    std::size_t node {};
+    if (_regex[_pos] == '(') {
+        ++_pos;
+        node = _parseAlternation();
+        assert(_pos < _regex.size() && _regex[_pos] == ')');
+        ++_pos;
+    }
+    else
+        node = _newNode(NodeType::Char, _regex[_pos++]);
+
+    for (; _pos < _regex.size(); ++_pos) {
+        NodeType type {};
+        switch (_regex[_pos]) {
+            case '*':
+                type = NodeType::Star;
+                break;
+            case '+':
+                type = NodeType::Plus;
+                break;
+            case '?':
+                type = NodeType::Optional;
+                break;
+            default:
+                return node;
+        }
+        auto parent = _newNode(type);
+        _nodes[parent].children.push_back(node);
+        node = parent;
+    }
+    return node;
+}
+
+template <typename Rng>
+inline void Sampler::_sample(std::size_t index, Rng& rng, std::string& out) const
+{
+    const auto& node = _nodes[index];
+    // repeat again with 1/2 chance, at most 8 times
+    auto repeat = [&](std::size_t count) {
+        for (; count < 8 && rng() % 2; ++count)
+            _sample(node.children.front(), rng, out);
+    };
+
+    switch (node.type) {
+        case NodeType::Char:
+            out += node.ch;
+            break;
+        case NodeType::Concat:
+            for (auto child : node.children)
+                _sample(child, rng, out);
+            break;
+        case NodeType::Alternation:
+            _sample(node.children[rng() % node.children.size()], rng, out);
+            break;
+        case NodeType::Plus:
+            _sample(node.children.front(), rng, out);
+            repeat(1);
+            break;
+        case NodeType::Star:
+            repeat(0);
+            break;
+        case NodeType::Optional:
+            if (rng() % 2)
+                _sample(node.children.front(), rng, out);
+            break;
+    }
+}
+
+/**
+ * @brief Tokens of every rule but the whitespace one [equally likely], separated by whitespace
+ * with noise_ratio > 0 the input doesn't match the grammar, see Lexer::setSkipUnmatched
+ */
+inline std::string makeText(const rules_t& rules, const corpus_config_t& config)
+{
+    std::vector<Sampler> samplers {};
+    for (const auto& [regex, value] : rules) {
+        if (value.second != "WS")
+            samplers.emplace_back(regex);
+    }
+    assert(!samplers.empty());
+
+    std::mt19937 rng { config.seed };
+    std::bernoulli_distribution noise { config.noise_ratio };
+    std::string text {};
+    text.reserve(config.size + 64);
+    while (text.size() < config.size) {
+        if (noise(rng)) {
+            for (auto length = 1 + rng() % 4; length--;)
+                text += NOISE[rng() % NOISE.size()];
+            text += ' ';
+        }
+        samplers[rng() % samplers.size()].sample(rng, text);
+        text += rng() % 8 == 0 ? '\n' : ' ';
+    }
+    return text;
+}
+} // namespace Synthetic
@@ -1,20 +1,69 @@
 #pragma once
+#include <FSA.hpp>
+#include <cstddef>
 #include <iostream>
-#include <string>
-
-struct Lexeme
-{
-    std::string value;
-};
+#include <string_view>
+#include <vector>
 
+/**
+ * @brief A token is a span of the input, building one never allocates
+ * type points into the token name table of the automaton [valid as long as the lexer],
+ * value points into the buffer [see Buffer::takeLexeme for its lifetime]
+ *
+ */
 struct Token
 {
-    std::string type;
-    std::string value;
+    FSA::kind_t kind { FSA::INVALID_KIND };
+    std::string_view type;
+    std::string_view value;
+    std::size_t offset {};
 
-    void print()
+    void print() const
     {
         std::cout << "type: " << type << " | "
                   << "value: " << value << std::endl;
     }
 };
+
+/**
+ * @brief Struct-of-arrays token storage for batch lexing
+ * clear() keeps the capacity, so a list reused across calls stops allocating
+ *
+ */
+struct TokenList
+{
+    std::vector<FSA::kind_t> kinds;
+    std::vector<std::size_t> offsets;
+    std::vector<std::size_t> lengths;
+
+    void clear() noexcept
+    {
+        kinds.clear();
+        offsets.clear();
+        lengths.clear();
+    }
+
+    void reserve(std::size_t size)
+    {
+        kinds.reserve(size);
+        offsets.reserve(size);
+        lengths.reserve(size);
+    }
+
+    void push(FSA::kind_t kind, std::size_t offset, std::size_t length)
+    {
+        kinds.push_back(kind);
+        offsets.push_back(offset);
+        lengths.push_back(length);
+    }
+
+    std::size_t size() const noexcept
+    {
+        return kinds.size();
+    }
+
+    bool empty() const noexcept
+    {
+        return kinds.empty();
+    }
+};
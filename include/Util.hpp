@@ -1,8 +1,10 @@
 #pragma once
 #include <FSA.hpp>
+#include <Profile.hpp>
 #include <ios>
 #include <stack>
 #include <string>
+#include <string_view>
 #include <cassert>
 
 namespace Util {
@@ -10,6 +12,7 @@ using str = FSA::str_t;
 
 inline void addConcatOperator(str& str)
 {
+    PROFILE_SCOPE("regex.concat");
     constexpr auto concatOperator = '^';
     enum class OperatorType {
         None,
@@ -65,6 +68,7 @@ inline void addConcatOperator(str& str)
  */
 inline void getPostfixAndChatSet(str& infix, FSA::set_t<char>& inputCharSet)
 {
+    PROFILE_SCOPE("regex.postfix");
     static const FSA::map_t<char, int> Priorities = {
         {'|',  2},
         { '^', 4},
@@ -122,6 +126,43 @@ inline void getPostfixAndChatSet(str& infix, FSA::set_t<char>& inputCharSet)
     infix = std::move(postfix);
 }
 
+/**
+ * @brief Escape the string to be the content of a C++ string literal
+ */
+inline str escapeString(const std::string_view& view)
+{
+    str escaped {};
+    for (const auto ch : view) {
+        switch (ch) {
+            case '"':
+                escaped += "\\\"";
+                break;
+            case '\\':
+                escaped += "\\\\";
+                break;
+            case '\n':
+                escaped += "\\n";
+                break;
+            case '\t':
+                escaped += "\\t";
+                break;
+            default:
+                auto byte = static_cast<unsigned char>(ch);
+                if (byte < 0x20 || byte >= 0x7f) {
+                    // 3 digits octal escape never swallows the following chars unlike \x
+                    escaped += '\\';
+                    escaped += static_cast<char>('0' + (byte >> 6));
+                    escaped += static_cast<char>('0' + ((byte >> 3) & 7));
+                    escaped += static_cast<char>('0' + (byte & 7));
+                }
+                else
+                    escaped += ch;
+                break;
+        }
+    }
+    return escaped;
+}
+
 // forward declaration for toDiagram
 #define IMPL_DRAGRAM                    \
     template <typename T>               \
@@ -1,5 +1,7 @@
 #include <DFA.hpp>
+#include <GrammarCache.hpp>
 #include <Lexer.hpp>
+#include <Profile.hpp>
 #include <Util.hpp>
 #include <fmt/format.h>
 #include <vector>
@@ -9,12 +11,28 @@ using namespace std;
 using namespace fmt;
 using namespace Color;
 
+PROFILE_ALLOCATION_HOOK()
 
 #if 1
+// lexer_generator [output header] [--direct|--table] [namespace] [--profile=<report.json>] [--cache=<dir>]
+// lexer_generator [output file] --binary [--profile=<report.json>] [--cache=<dir>]
 int main(int argc, char* argv[])
 {
-    NFA nfa;
-    map<FSA::str_t, pair<NFA::priority_t, FSA::str_t>> test_cases {
+    // the profile and cache flags may come anywhere, the rest are positional
+    vector<FSA::str_t> args {};
+    FSA::str_t profile_report {};
+    FSA::str_t cache_directory {};
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg { argv[i] };
+        if (arg.starts_with("--profile="))
+            profile_report = arg.substr(arg.find('=') + 1);
+        else if (arg.starts_with("--cache="))
+            cache_directory = arg.substr(arg.find('=') + 1);
+        else
+            args.emplace_back(arg);
+    }
+
+    NFA::rules_t test_cases {
         {"<(Leader|Tab)>",  { 4, "Key" } },
         { "b",  { 2, "B" } },
         { "c",  { 3, "C" } },
@@ -26,54 +44,79 @@ int main(int argc, char* argv[])
         cout << Yellow << "Regex : " << key << " | "
              << "Priority :" << value.first << " | "
              << "Type : " << value.second << Endl;
-        auto str1 = key;
-        auto str2 = value.second;
-        auto tmp = NFA(str1, str2, value.first);
-
-
-        nfa = nfa + tmp;
     }
 
     cout << Green << "======================" << Endl;
 
-    DFA dfa(nfa);
-    // FIXME :
-    // Error state info and priority
-    // Error exception
+    auto build = [&test_cases]() {
+        DFA dfa(NFA::fromRules(test_cases), std::thread::hardware_concurrency());
+        dfa.minimal();
+        return dfa;
+    };
+
+    // an unchanged grammar is mapped from the cache instead of built
+    optional<GrammarCache> cache {};
+    optional<MappedDFA> cached {};
+    if (!cache_directory.empty()) {
+        cache.emplace(cache_directory);
+        cached = cache->find(test_cases);
+        cout << Color::Green << (cached ? "Cache hit: " : "Cache miss: ")
+             << cache->getPath(test_cases).string() << Color::Endl;
+    }
+
+    DFA dfa = cached ? DFA(*cached) : build();
+    if (cache && !cached && !cache->store(test_cases, dfa))
+        cout << Color::Red << "Can't write the cache: " << cache_directory << Color::Endl;
 
-    // BUG : minimal dfa cause state info error
-    // dfa.minimal();
 
+    if (args.size() > 1 && args[1] == "--binary") {
+        // the compiled tables only, loaded at runtime by MappedDFA
+        if (dfa.saveBinaryTo(args[0]))
+            cout << Color::Green << "DFA saved: " << args[0] << Color::Endl;
+        else
+            cout << Color::Red << "Can't write: " << args[0] << Color::Endl;
+    }
+    else if (!args.empty()) {
+        auto format = args.size() > 1 && args[1] == "--direct" ? FSA::LexerFmt::DIRECT
+                                                              : FSA::LexerFmt::TABLE;
+        auto name = args.size() > 2 ? args[2] : FSA::str_t { "generated" };
+        dfa.saveLexerTo(args[0], format, name);
+        cout << Color::Green << "Lexer generated: " << args[0] << Color::Endl;
+    }
 
     constexpr auto str = "bbc<b<Leader><Tab>cc";
     cout << Color::Green << "Test Str:" << str << Color::Endl;
 
     istringstream iss(str);
     Lexer lexer(iss, dfa);
-    while (true) {
-        auto token = lexer.nextToken();
-        if (!token)
-            break;
-        token->print();
+    // the stray "<" of "<b" is noise, not an error
+    lexer.setSkipUnmatched();
+    {
+        PROFILE_SCOPE("lexer.scan");
+        while (true) {
+            auto token = lexer.nextToken();
+            if (!token)
+                break;
+            token->print();
+        }
     }
 
+    if (!profile_report.empty()) {
+        if (Profile::saveReport(profile_report))
+            cout << Color::Green << "Profile report: " << profile_report << Color::Endl;
+        else
+            cout << Color::Red << "Profiling is not compiled in [xmake f --profile=y]" << Color::Endl;
+    }
     return 0;
 }
 
 #else
 int main(int argc, char* argv[])
 {
-    NFA nfa;
-    map<NFA::str_t, pair<NFA::priority_t, NFA::state_info_t>> test {
+    NFA::rules_t test {
 
     };
-
-    for (auto& [key, value] : test) {
-        auto str1 = key;
-        auto str2 = value.second;
-        auto tmp = NFA(str1, str2, value.first);
-        nfa = nfa + tmp;
-    }
+    auto nfa = NFA::fromRules(test);
 
     constexpr auto filename = "README.md";
     std::remove(filename);
@@ -0,0 +1,59 @@
+#include <Synthetic.hpp>
+#include <Util.hpp>
+#include <color.h>
+#include <fmt/format.h>
+#include <fstream>
+#include <string>
+
+using namespace std;
+using namespace Color;
+
+// synthetic <rule count> <grammar header> [corpus file] [corpus size] [noise ratio] [seed]
+int main(int argc, char* argv[])
+{
+    if (argc < 3) {
+        cout << Red
+             << "Usage: synthetic <rule count> <grammar header> [corpus file] [corpus size] "
+                "[noise ratio] [seed]"
+             << Endl;
+        return 1;
+    }
+
+    const auto rule_count = stoull(argv[1]);
+    const auto seed = argc > 6 ? static_cast<uint32_t>(stoul(argv[6])) : 1u;
+    const auto rules = Synthetic::makeGrammar(rule_count, seed);
+
+    // the same shape as the rules of src/main.cpp
+    ofstream header { argv[2], ios_base::out | ios_base::binary };
+    assert(header.is_open());
+    header << "// Generated by synthetic, do not edit\n"
+              "#pragma once\n"
+              "#include <cstdint>\n"
+              "#include <map>\n"
+              "#include <string>\n"
+              "#include <utility>\n"
+              "\n"
+              "inline const std::map<std::string, std::pair<std::int32_t, std::string>> synthetic_rules {\n";
+    for (auto& [regex, value] : rules)
+        header << fmt::format(
+            "    {{\"{}\", {{ {}, \"{}\" }}}},\n",
+            Util::escapeString(regex),
+            value.first,
+            Util::escapeString(value.second));
+    header << "};\n";
+    cout << Green << "Grammar generated: " << argv[2] << " [" << rules.size() << " rules]" << Endl;
+
+    if (argc > 3) {
+        Synthetic::corpus_config_t config {};
+        config.size = argc > 4 ? stoull(argv[4]) : 1 << 20;
+        config.noise_ratio = argc > 5 ? stod(argv[5]) : 0;
+        config.seed = seed + 1;
+
+        const auto text = Synthetic::makeText(rules, config);
+        ofstream corpus { argv[3], ios_base::out | ios_base::binary };
+        assert(corpus.is_open());
+        corpus << text;
+        cout << Green << "Corpus generated: " << argv[3] << " [" << text.size() << " bytes]" << Endl;
+    }
+    return 0;
+}
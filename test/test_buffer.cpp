@@ -2,21 +2,115 @@
 #include <fstream>
 #include <cassert>
 #include <gtest/gtest.h>
+#include <sstream>
+
+constexpr auto filename = "../test.txt";
+
+TEST(BufferTest, lazyLineAndColumn)
+{
+    Buffer buffer(std::string_view { "ab\ncd\n" });
+    for (int i = 0; i < 4; ++i)
+        buffer.next();
+
+    EXPECT_EQ(buffer.peek(), 'd');
+    EXPECT_EQ(buffer.getLineNr(), 1);
+    EXPECT_EQ(buffer.getColumn(), 1);
+
+    buffer.rollback(1);
+    EXPECT_EQ(buffer.getLineNr(), 0);
+    EXPECT_EQ(buffer.getColumn(), 1);
+
+    buffer.rollback(6);
+    EXPECT_EQ(buffer.peek(), Buffer::EOF_CHAR);
+    EXPECT_EQ(buffer.getLineNr(), 2);
+    EXPECT_EQ(buffer.getColumn(), 0);
+}
+
+TEST(BufferTest, takeLexeme)
+{
+    std::istringstream iss("hello world");
+    Buffer buffer(iss);
+    buffer.markLexemeStart();
+    while (buffer.peek() != ' ')
+        buffer.next();
+    EXPECT_EQ(buffer.takeLexeme(), "hello");
+}
+
+TEST(BufferTest, mappedFile)
+{
+    std::ifstream ifs(filename);
+    std::stringstream content;
+    content << ifs.rdbuf();
+
+    auto buffer = Buffer::fromFile(filename);
+    buffer.markLexemeStart();
+    while (buffer.peek() != Buffer::EOF_CHAR)
+        buffer.next();
+    EXPECT_EQ(buffer.takeLexeme(), content.str());
+    EXPECT_EQ(buffer.getLineNr(), 35);
+}
+
+TEST(BufferTest, streamCarriesLexemeAcrossRefills)
+{
+    std::istringstream iss("first\nsecond_lexeme\nthird");
+    Buffer buffer(iss, 4);
+    EXPECT_FALSE(buffer.isContiguous());
+
+    std::vector<std::string> lexemes {};
+    while (buffer.peek() != Buffer::EOF_CHAR) {
+        buffer.markLexemeStart();
+        while (buffer.peek() != '\n' && buffer.peek() != Buffer::EOF_CHAR)
+            buffer.next();
+        lexemes.emplace_back(buffer.takeLexeme());
+        if (buffer.peek() == '\n')
+            buffer.next();
+    }
+    EXPECT_EQ(lexemes, (std::vector<std::string> { "first", "second_lexeme", "third" }));
+    EXPECT_EQ(buffer.getLineNr(), 2);
+    EXPECT_EQ(buffer.getColumn(), 5);
+}
+
+TEST(BufferTest, streamRollbackInsideLexeme)
+{
+    std::istringstream iss("abcdefgh");
+    Buffer buffer(iss, 2);
+    buffer.next();
+    buffer.markLexemeStart();
+    auto start = buffer.getPos();
+    for (int i = 0; i < 5; ++i)
+        buffer.take();
+
+    // backtrack as the lexer does for the longest match
+    buffer.rollback(start + 2);
+    EXPECT_EQ(buffer.peek(), 'd');
+    EXPECT_EQ(buffer.takeLexeme(), "bc");
+}
+
+TEST(BufferTest, streamFromFd)
+{
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    constexpr std::string_view content = "token1 token2\ntoken3";
+    ASSERT_EQ(write(fds[1], content.data(), content.size()), content.size());
+    close(fds[1]);
+
+    auto buffer = Buffer::fromFd(fds[0], 3);
+    buffer.markLexemeStart();
+    while (buffer.peek() != Buffer::EOF_CHAR)
+        buffer.next();
+    EXPECT_EQ(buffer.takeLexeme(), content);
+    EXPECT_EQ(buffer.getLineNr(), 1);
+    close(fds[0]);
+}
 
 int main(int argc, char** argv)
 {
-    constexpr auto filename = "../test.txt";
     std::ifstream ifs(filename);
     assert(ifs.is_open());
 
-    Buffer buffer(ifs);
+    auto buffer = Buffer::fromFile(filename);
     buffer.printLines();
 
     testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
 }
-
-// TEST :
-// TEST(Unit Name, Test Name) {
-//     TODO : Your Test
-// }
@@ -0,0 +1,247 @@
+#include <DFA.hpp>
+#include <gtest/gtest.h>
+
+class DFATest: public ::testing::Test
+{
+protected:
+    NFA nfa;
+
+    DFATest():
+        nfa(NFA::fromRules({
+            {"ab",   { 2, "AB" }},
+            { "a+",  { 1, "A" } },
+            { "c|d", { 3, "CD" }},
+    }))
+    {
+    }
+
+    /**
+     * @brief walk the dfa via the compiled table, return the dead state if stuck
+     */
+    static DFA::state_t walk(const DFA& dfa, const FSA::str_t& str)
+    {
+        auto state = dfa.getStartState();
+        for (auto ch : str)
+            state = dfa.getNextState(state, ch);
+        return state;
+    }
+};
+
+TEST_F(DFATest, compiledTableAgreesWithReachedState)
+{
+    DFA dfa(nfa);
+    auto state = dfa.getStartState();
+    for (auto ch : FSA::str_t { "aab" }) {
+        auto reached = dfa.getReachedState(state, ch);
+        auto next = dfa.getNextState(state, ch);
+        if (reached)
+            EXPECT_EQ(*reached, next);
+        else
+            EXPECT_EQ(next, dfa.getDeadState());
+        state = next;
+    }
+}
+
+TEST_F(DFATest, deadStateIsAbsorbing)
+{
+    DFA dfa(nfa);
+    auto dead = dfa.getDeadState();
+    EXPECT_EQ(walk(dfa, "x"), dead);
+    EXPECT_EQ(walk(dfa, "ba"), dead);
+    for (int ch = 0; ch < 256; ++ch)
+        EXPECT_EQ(dfa.getNextState(dead, static_cast<FSA::char_t>(ch)), dead);
+    EXPECT_FALSE(dfa.isFinalState(dead));
+}
+
+TEST_F(DFATest, charClasses)
+{
+    DFA dfa(nfa);
+    // {others}, {a}, {b}, {c}, {d}
+    EXPECT_EQ(dfa.getClassCount(), 5);
+    EXPECT_EQ(dfa.getCharClass('x'), dfa.getCharClass('\0'));
+    EXPECT_NE(dfa.getCharClass('a'), dfa.getCharClass('b'));
+    EXPECT_NE(dfa.getCharClass('a'), dfa.getCharClass('x'));
+}
+
+TEST_F(DFATest, acceptStates)
+{
+    DFA dfa(nfa);
+    EXPECT_TRUE(dfa.isFinalState(walk(dfa, "ab")));
+    EXPECT_TRUE(dfa.isFinalState(walk(dfa, "aaa")));
+    EXPECT_TRUE(dfa.isFinalState(walk(dfa, "d")));
+    EXPECT_FALSE(dfa.isFinalState(walk(dfa, "")));
+    EXPECT_EQ(dfa.getStateInfo(walk(dfa, "ab")), "AB");
+    EXPECT_EQ(dfa.getStateInfo(walk(dfa, "c")), "CD");
+}
+
+TEST_F(DFATest, minimalKeepsLanguageAndTokens)
+{
+    DFA dfa(nfa);
+    DFA minimal(nfa);
+    minimal.minimal();
+    EXPECT_LT(minimal.getStateCount(), dfa.getStateCount());
+    EXPECT_EQ(minimal.getStartState(), 0);
+
+    for (FSA::str_t str : { "a", "aa", "aaaa", "ab", "aab", "abb", "b", "c", "d", "cd", "x", "" }) {
+        auto state = walk(dfa, str), minimal_state = walk(minimal, str);
+        EXPECT_EQ(state == dfa.getDeadState(), minimal_state == minimal.getDeadState()) << str;
+        EXPECT_EQ(dfa.getAcceptKind(state), minimal.getAcceptKind(minimal_state)) << str;
+    }
+
+    // c and d are equivalent once their end states are merged
+    EXPECT_EQ(minimal.getCharClass('c'), minimal.getCharClass('d'));
+    EXPECT_EQ(minimal.getClassCount(), 4);
+}
+
+TEST_F(DFATest, minimalIsIdempotent)
+{
+    DFA dfa(nfa);
+    dfa.minimal();
+    auto state_count = dfa.getStateCount();
+    dfa.minimal();
+    EXPECT_EQ(dfa.getStateCount(), state_count);
+}
+
+// the containers must keep their arena through swap and assignment [run under -fsanitize=address]
+TEST_F(DFATest, swapAndAssignKeepTheArena)
+{
+    DFA a(nfa), b(nfa);
+    b.minimal();
+    const auto a_states = a.getStateCount(), b_states = b.getStateCount();
+
+    std::swap(a, b);
+    EXPECT_EQ(a.getStateCount(), b_states);
+    EXPECT_EQ(b.getStateCount(), a_states);
+    EXPECT_EQ(DFA(b).toDotString(), b.toDotString());
+    testing::internal::CaptureStdout();
+    a.printStateInfo();
+    b.printStateInfo();
+    EXPECT_FALSE(testing::internal::GetCapturedStdout().empty());
+
+    DFA c(nfa);
+    c = a;
+    EXPECT_EQ(c.toDotString(), a.toDotString());
+    c = b;
+    EXPECT_EQ(c.toDotString(), b.toDotString());
+    c = std::move(a);
+    EXPECT_EQ(c.getStateCount(), b_states);
+    a = c;
+    a.minimal();
+    EXPECT_EQ(a.toDotString(), c.toDotString());
+}
+
+TEST(DFAMinimal, differentTokensAreNotMerged)
+{
+    DFA dfa(NFA::fromRules({
+        {"xa",  { 1, "XA" }},
+        { "xb", { 1, "XB" }},
+        { "ya", { 1, "YA" }},
+    }));
+    dfa.minimal();
+    auto walk = [&dfa](const FSA::str_t& str) {
+        auto state = dfa.getStartState();
+        for (auto ch : str)
+            state = dfa.getNextState(state, ch);
+        return state;
+    };
+    EXPECT_EQ(dfa.getStateInfo(walk("xa")), "XA");
+    EXPECT_EQ(dfa.getStateInfo(walk("xb")), "XB");
+    EXPECT_EQ(dfa.getStateInfo(walk("ya")), "YA");
+    EXPECT_NE(walk("xa"), walk("xb"));
+}
+
+TEST(StateSetTable, internsDistinctSets)
+{
+    StateSetTable sets {};
+    std::vector<FSA::state_t> a { 1, 3, 5 }, b { 1, 3 }, empty {};
+
+    EXPECT_EQ(sets.intern(a), std::make_pair(FSA::state_t { 0 }, true));
+    EXPECT_EQ(sets.intern(b), std::make_pair(FSA::state_t { 1 }, true));
+    EXPECT_EQ(sets.intern(empty), std::make_pair(FSA::state_t { 2 }, true));
+    EXPECT_EQ(sets.intern(a), std::make_pair(FSA::state_t { 0 }, false));
+
+    // survive the rehash
+    for (FSA::state_t i = 0; i < 1000; ++i) {
+        std::vector<FSA::state_t> set { i, i + 1 };
+        sets.intern(set);
+    }
+    EXPECT_EQ(sets.intern(b), std::make_pair(FSA::state_t { 1 }, false));
+    EXPECT_TRUE(std::ranges::equal(sets.get(0), a));
+    EXPECT_EQ(sets.size(), 1003);
+}
+
+TEST_F(DFATest, subsetStatesAreBreadthFirst)
+{
+    DFA dfa(nfa);
+    EXPECT_EQ(dfa.getStartState(), 0);
+    // every state is reached from a smaller one
+    for (DFA::state_t state = 1; state < dfa.getStateCount(); ++state) {
+        bool reached = false;
+        for (DFA::state_t from = 0; from < state && !reached; ++from)
+            for (auto ch : FSA::str_t { "abcd" })
+                reached = reached || dfa.getNextState(from, ch) == state;
+        EXPECT_TRUE(reached) << state;
+    }
+}
+
+TEST(DFAParallel, sameNumberingAsSequential)
+{
+    NFA::rules_t rules {
+        { "(a|b|c|d|e|f)(a|b|c|d|e|f|0|1)*", { 1, "ID" } },
+    };
+    for (FSA::str_t keyword : { "abc", "bad", "cafe", "dead", "beef", "face", "fade", "decade" })
+        rules.emplace(keyword, std::make_pair(2, keyword));
+    const auto nfa = NFA::fromRules(rules);
+
+    DFA sequential(nfa);
+    for (std::size_t thread_count : { 1, 2, 4, 8 }) {
+        DFA parallel(nfa, thread_count);
+        ASSERT_EQ(parallel.getStateCount(), sequential.getStateCount());
+        ASSERT_EQ(parallel.getClassCount(), sequential.getClassCount());
+        EXPECT_EQ(parallel.getStartState(), sequential.getStartState());
+        EXPECT_EQ(parallel.getTokenNames(), sequential.getTokenNames());
+        for (DFA::state_t state = 0; state < sequential.getStateCount(); ++state) {
+            EXPECT_EQ(parallel.isFinalState(state), sequential.isFinalState(state));
+            EXPECT_EQ(parallel.getAcceptKind(state), sequential.getAcceptKind(state));
+            for (int ch = -128; ch < 128; ++ch)
+                EXPECT_EQ(parallel.getNextState(state, ch), sequential.getNextState(state, ch));
+        }
+    }
+}
+
+TEST_F(DFATest, selfLoops)
+{
+    DFA dfa(nfa);
+    dfa.minimal();
+
+    // a+ loops on a, ab and c|d end right away
+    const auto* loop = dfa.getSelfLoop(walk(dfa, "aa"));
+    ASSERT_NE(loop, nullptr);
+    EXPECT_TRUE(loop->contains('a'));
+    EXPECT_FALSE(loop->contains('b'));
+    EXPECT_EQ(loop->countPrefix("aaab"), 3);
+    EXPECT_EQ(dfa.getSelfLoop(dfa.getStartState()), nullptr);
+    EXPECT_EQ(dfa.getSelfLoop(walk(dfa, "c")), nullptr);
+}
+
+TEST(DFAStartScan, literalPrefixAndNoise)
+{
+    DFA dfa(NFA::fromRules({
+        {"<Lead(er)?>", { 1, "LEADER" }},
+        { "<Lx>",       { 1, "LX" }    },
+    }));
+    dfa.minimal();
+    EXPECT_EQ(dfa.getLiteralPrefix(), "<L");
+
+    const auto* noise = dfa.getNoiseSet();
+    ASSERT_NE(noise, nullptr);
+    EXPECT_FALSE(noise->contains('<'));
+    EXPECT_TRUE(noise->contains('L'));
+    EXPECT_EQ(noise->countPrefix("abc <L"), 4);
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,108 @@
+#include <GrammarCache.hpp>
+#include <Lexer.hpp>
+#include <Synthetic.hpp>
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+
+template <typename lexer_t>
+static std::vector<std::pair<std::string, std::string>> tokenize(lexer_t& lexer)
+{
+    std::vector<std::pair<std::string, std::string>> tokens {};
+    while (auto token = lexer.nextToken())
+        tokens.emplace_back(token->type, token->value);
+    return tokens;
+}
+
+class GrammarCacheTest: public ::testing::Test
+{
+protected:
+    std::filesystem::path directory { std::filesystem::temp_directory_path() / "test_grammar_cache" };
+    GrammarCache cache { directory };
+    GrammarCache::rules_t rules { Synthetic::makeGrammar(32) };
+
+    GrammarCacheTest()
+    {
+        std::filesystem::remove_all(directory);
+    }
+
+    ~GrammarCacheTest() override
+    {
+        std::filesystem::remove_all(directory);
+    }
+};
+
+TEST_F(GrammarCacheTest, keyFollowsTheRules)
+{
+    EXPECT_EQ(GrammarCache::getKey(rules), GrammarCache::getKey(Synthetic::makeGrammar(32)));
+
+    auto changed = rules;
+    changed.begin()->second.first += 1;
+    EXPECT_NE(GrammarCache::getKey(changed), GrammarCache::getKey(rules));
+
+    changed = rules;
+    changed.begin()->second.second += "_";
+    EXPECT_NE(GrammarCache::getKey(changed), GrammarCache::getKey(rules));
+
+    changed = rules;
+    changed.emplace("zz", std::make_pair(2, "ZZ"));
+    EXPECT_NE(GrammarCache::getKey(changed), GrammarCache::getKey(rules));
+
+    // the fields don't run into each other
+    EXPECT_NE(GrammarCache::getKey({ { "ab", { 1, "c" } } }), GrammarCache::getKey({ { "a", { 1, "bc" } } }));
+    // the priority digits don't run into the length of the type
+    EXPECT_NE(GrammarCache::getKey({ { "a", { 1, "TWELVE_CHARS" } } }),
+              GrammarCache::getKey({ { "a", { 11, "XY" } } }));
+}
+
+TEST_F(GrammarCacheTest, builtOnceThenMapped)
+{
+    EXPECT_FALSE(cache.find(rules));
+    auto built = cache.getOrBuild(rules);
+    ASSERT_TRUE(built);
+    EXPECT_TRUE(std::filesystem::exists(cache.getPath(rules)));
+
+    auto mapped = cache.find(rules);
+    ASSERT_TRUE(mapped);
+    EXPECT_EQ(mapped->getStateCount(), built->getStateCount());
+
+    // another grammar gets its own entry
+    EXPECT_FALSE(cache.find(Synthetic::makeGrammar(33)));
+}
+
+TEST_F(GrammarCacheTest, sameTokensAsBuiltDFA)
+{
+    DFA dfa { NFA::fromRules(rules) };
+    dfa.minimal();
+    ASSERT_TRUE(cache.store(rules, dfa));
+
+    auto mapped = cache.find(rules);
+    ASSERT_TRUE(mapped);
+    const auto input = Synthetic::makeText(rules, { .size = 4096 });
+    Lexer lexer(Buffer { input }, dfa);
+    Lexer rebuilt_lexer(Buffer { input }, DFA { *mapped });
+    MappedLexer mapped_lexer(Buffer { input }, *mapped);
+    const auto tokens = tokenize(lexer);
+    EXPECT_EQ(tokenize(rebuilt_lexer), tokens);
+    EXPECT_EQ(tokenize(mapped_lexer), tokens);
+}
+
+TEST_F(GrammarCacheTest, damagedEntryRebuilt)
+{
+    ASSERT_TRUE(cache.getOrBuild(rules));
+    const auto path = cache.getPath(rules);
+    {
+        std::fstream file { path, std::ios_base::in | std::ios_base::out | std::ios_base::binary };
+        file.seekp(-1, std::ios_base::end);
+        file.put('\xff');
+    }
+    EXPECT_FALSE(cache.find(rules));
+    EXPECT_TRUE(cache.getOrBuild(rules));
+    EXPECT_TRUE(cache.find(rules));
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
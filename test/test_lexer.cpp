@@ -0,0 +1,302 @@
+#include <Lexer.hpp>
+#include <gtest/gtest.h>
+#include <sstream>
+
+using rules_t = NFA::rules_t;
+
+static DFA buildDFA(const rules_t& rules)
+{
+    return DFA(NFA::fromRules(rules));
+}
+
+template <typename lexer_t>
+static std::vector<std::pair<std::string, std::string>> tokenize(lexer_t& lexer)
+{
+    std::vector<std::pair<std::string, std::string>> tokens {};
+    while (auto token = lexer.nextToken())
+        tokens.emplace_back(token->type, token->value);
+    return tokens;
+}
+
+class LexerTest: public ::testing::Test
+{
+protected:
+    DFA dfa;
+
+    LexerTest():
+        dfa(buildDFA({
+            {"ab",   { 2, "AB" }},
+            { "a+",  { 1, "A" } },
+            { "c|d", { 3, "CD" }},
+            { " +",  { 0, "WS" }},
+    }))
+    {
+    }
+};
+
+TEST_F(LexerTest, tokenSpans)
+{
+    constexpr std::string_view input = "aaa ab d";
+    Lexer lexer(Buffer { input }, dfa);
+
+    std::vector<std::size_t> offsets {};
+    std::vector<std::string_view> types {};
+    while (auto token = lexer.nextToken()) {
+        offsets.push_back(token->offset);
+        types.push_back(token->type);
+        EXPECT_EQ(token->value, input.substr(token->offset, token->value.size()));
+        EXPECT_EQ(dfa.getTokenName(token->kind), token->type);
+    }
+    EXPECT_EQ(offsets, (std::vector<std::size_t> { 0, 3, 4, 6, 7 }));
+    EXPECT_EQ(types, (std::vector<std::string_view> { "A", "WS", "AB", "WS", "CD" }));
+}
+
+TEST(LexerBacktrack, longestMatchRollsBack)
+{
+    auto dfa = buildDFA({
+        {"abc", { 3, "ABC" }},
+        { "a",  { 1, "A" }  },
+        { "b",  { 2, "B" }  },
+    });
+
+    Lexer lexer(Buffer { std::string_view { "ababc" } }, dfa);
+    using tokens_t = std::vector<std::pair<std::string, std::string>>;
+    EXPECT_EQ(tokenize(lexer), (tokens_t { { "A", "a" }, { "B", "b" }, { "ABC", "abc" } }));
+}
+
+TEST_F(LexerTest, streamedInput)
+{
+    std::istringstream iss("aaaa ab c  dd");
+    Lexer lexer(Buffer { iss, 3 }, dfa);
+    using tokens_t = std::vector<std::pair<std::string, std::string>>;
+    EXPECT_EQ(
+        tokenize(lexer),
+        (tokens_t {
+            { "A", "aaaa" },
+            { "WS", " " },
+            { "AB", "ab" },
+            { "WS", " " },
+            { "CD", "c" },
+            { "WS", "  " },
+            { "CD", "d" },
+            { "CD", "d" },
+    }));
+}
+
+TEST_F(LexerTest, minimizedDFA)
+{
+    constexpr std::string_view input = "aaa ab d  c";
+    auto minimal = dfa;
+    minimal.minimal();
+    Lexer lexer(Buffer { input }, dfa);
+    Lexer minimal_lexer(Buffer { input }, minimal);
+    EXPECT_EQ(tokenize(lexer), tokenize(minimal_lexer));
+}
+
+TEST_F(LexerTest, batchTokens)
+{
+    constexpr std::string_view input = "aaa ab d  c";
+    Lexer lexer(Buffer { input }, dfa);
+    Lexer batch_lexer(Buffer { input }, dfa);
+
+    std::vector<Token> tokens {};
+    EXPECT_EQ(batch_lexer.getAllTokens(tokens), 7);
+    for (const auto& token : tokens) {
+        auto expected = lexer.nextToken();
+        ASSERT_TRUE(expected);
+        EXPECT_EQ(token.kind, expected->kind);
+        EXPECT_EQ(token.value, expected->value);
+        EXPECT_EQ(token.offset, expected->offset);
+    }
+    EXPECT_FALSE(lexer.nextToken());
+}
+
+TEST_F(LexerTest, batchTokenListReusesCapacity)
+{
+    TokenList tokens {};
+    std::istringstream iss("aaa ab d  c");
+    Lexer lexer(Buffer { iss, 2 }, dfa);
+    EXPECT_EQ(lexer.getAllTokens(tokens), 7);
+    EXPECT_EQ(tokens.offsets, (std::vector<std::size_t> { 0, 3, 4, 6, 7, 8, 10 }));
+    EXPECT_EQ(tokens.lengths, (std::vector<std::size_t> { 3, 1, 2, 1, 1, 2, 1 }));
+    EXPECT_EQ(dfa.getTokenName(tokens.kinds[2]), "AB");
+
+    auto capacity = tokens.kinds.capacity();
+    Lexer other(Buffer { std::string_view { "ab a" } }, dfa);
+    EXPECT_EQ(other.getAllTokens(tokens), 3);
+    EXPECT_EQ(tokens.kinds.capacity(), capacity);
+}
+
+TEST(LazyLexer, sameTokensAsDFA)
+{
+    rules_t rules {
+        {"if",                  { 2, "IF" }},
+        { "(i|f|x)(i|f|x|0)*", { 1, "ID" }},
+        { " +",                 { 0, "WS" }},
+    };
+    auto nfa = NFA::fromRules(rules);
+    constexpr std::string_view input = "if iff x0 fi  if0 xif";
+
+    Lexer lexer(Buffer { input }, DFA(nfa));
+    LazyLexer lazy_lexer(Buffer { input }, LazyDFA(nfa));
+    EXPECT_EQ(tokenize(lazy_lexer), tokenize(lexer));
+}
+
+TEST(LazyLexer, flushedCacheKeepsScanning)
+{
+    auto nfa = NFA::fromRules({
+        {"(a|b)*abb", { 1, "ABB" }},
+        { "a|b",      { 0, "AB" } },
+    });
+    constexpr std::string_view input = "abababbbaabbababaabb";
+
+    // a budget below one state flushes on every miss
+    LazyDFA lazy_dfa(nfa, 1);
+    LazyLexer lazy_lexer(Buffer { input }, lazy_dfa);
+    Lexer lexer(Buffer { input }, DFA(nfa));
+    EXPECT_EQ(tokenize(lazy_lexer), tokenize(lexer));
+
+    LazyDFA cached(nfa);
+    for (auto ch : input)
+        cached.getNextState(cached.getStartState(), ch);
+    EXPECT_EQ(cached.getResetCount(), 0);
+    EXPECT_LE(cached.getCachedStateCount(), 3);
+}
+
+TEST(ParallelLexer, sameTokensAsSequential)
+{
+    // a quoted string spans spaces, so a chunk starting inside one guesses wrong tokens
+    auto dfa = buildDFA({
+        {"'(a|b| )*'", { 2, "STR" }},
+        { "(a|b)+",    { 1, "ID" } },
+        { " +",        { 0, "WS" } },
+        { "\n",        { 0, "NL" } },
+    });
+
+    std::string input {};
+    for (int i = 0; input.size() < 1024 * 1024; ++i) {
+        input += i % 7 == 0 ? "'ab ba  b' " : "ab  ba ";
+        if (i % 13 == 0)
+            input += '\n';
+    }
+
+    TokenList expected {};
+    Lexer(Buffer { std::string_view { input } }, dfa).getAllTokens(expected);
+    for (std::size_t thread_count : { 1, 2, 3, 8 }) {
+        for (auto sync : { std::optional<char> {}, std::optional<char> { '\n' } }) {
+            TokenList tokens {};
+            Lexer lexer(Buffer { std::string_view { input } }, dfa);
+            EXPECT_EQ(lexer.getAllTokens(tokens, thread_count, sync), expected.size());
+            EXPECT_EQ(tokens.kinds, expected.kinds);
+            EXPECT_EQ(tokens.offsets, expected.offsets);
+            EXPECT_EQ(tokens.lengths, expected.lengths);
+            EXPECT_FALSE(lexer.nextToken());
+        }
+    }
+}
+
+TEST_F(LexerTest, longRunsAcrossRefills)
+{
+    std::string input {};
+    for (std::size_t run = 1; run < 80; run += 7)
+        input += std::string(run, 'a') + std::string(run, ' ') + "ab" + std::string(run, ' ') + "c";
+
+    Lexer lexer(Buffer { std::string_view { input } }, dfa);
+    auto expected = tokenize(lexer);
+    EXPECT_EQ(expected.front(), (std::pair<std::string, std::string> { "A", "a" }));
+    EXPECT_EQ(expected.size(), 12 * 5);
+
+    std::istringstream iss(input);
+    Lexer streamed(Buffer { iss, 7 }, dfa);
+    EXPECT_EQ(tokenize(streamed), expected);
+}
+
+TEST(LexerSkipUnmatched, tokensInNoise)
+{
+    rules_t rules {
+        {"<(Leader|Tab)>",   { 1, "KEY" }},
+        { "<(Leader|Tab)-x>", { 2, "KEYX" }},
+    };
+    auto nfa = NFA::fromRules(rules);
+    DFA dfa(nfa);
+    dfa.minimal();
+    ASSERT_EQ(dfa.getLiteralPrefix(), "<");
+
+    std::string input = "bbc<b<Leader><Tab>cc<Tab-x";
+    for (int i = 0; i < 20; ++i)
+        input += std::string(97, 'z') + "<Le<Leader-x>" + "<<Tab>";
+    using tokens_t = std::vector<std::pair<std::string, std::string>>;
+
+    Lexer lexer(Buffer { std::string_view { input } }, dfa);
+    lexer.setSkipUnmatched();
+    auto tokens = tokenize(lexer);
+    ASSERT_EQ(tokens.size(), 2 + 20 * 2);
+    EXPECT_EQ(tokens[0], (tokens_t::value_type { "KEY", "<Leader>" }));
+    EXPECT_EQ(tokens[1], (tokens_t::value_type { "KEY", "<Tab>" }));
+    EXPECT_EQ(tokens[2], (tokens_t::value_type { "KEYX", "<Leader-x>" }));
+
+    // the window cuts the prefixes and tokens everywhere
+    std::istringstream iss(input);
+    Lexer streamed(Buffer { iss, 5 }, dfa);
+    streamed.setSkipUnmatched();
+    EXPECT_EQ(tokenize(streamed), tokens);
+
+    // no prefix nor noise set to jump with
+    LazyLexer lazy_lexer(Buffer { std::string_view { input } }, LazyDFA(nfa));
+    lazy_lexer.setSkipUnmatched();
+    EXPECT_EQ(tokenize(lazy_lexer), tokens);
+}
+
+// a candidate cut by the end of input is skipped like any other unmatched char
+TEST(LexerSkipUnmatched, candidateAtEndOfInput)
+{
+    auto dfa = buildDFA({
+        {"abc", { 2, "ABC" }},
+        { "b",  { 1, "B" }  },
+    });
+    using tokens_t = std::vector<std::pair<std::string, std::string>>;
+
+    for (std::string input : { "ab", "xab", "abcab" }) {
+        Lexer lexer(Buffer { std::string_view { input } }, dfa);
+        lexer.setSkipUnmatched();
+        auto tokens = tokenize(lexer);
+        ASSERT_FALSE(tokens.empty()) << input;
+        EXPECT_EQ(tokens.back(), (tokens_t::value_type { "B", "b" })) << input;
+    }
+
+    std::istringstream iss("xab");
+    Lexer streamed(Buffer { iss, 2 }, dfa);
+    streamed.setSkipUnmatched();
+    EXPECT_EQ(tokenize(streamed), (tokens_t { { "B", "b" } }));
+}
+
+TEST(LexerSkipUnmatched, parallelSameAsSequential)
+{
+    auto dfa = buildDFA({
+        {"'(a|b| )*'", { 2, "STR" }},
+        { "(a|b)+",    { 1, "ID" } },
+    });
+
+    std::string input {};
+    for (int i = 0; input.size() < 1024 * 1024; ++i)
+        input += i % 5 == 0 ? "xx 'ab ba' y" : "ab ..ba";
+
+    TokenList expected {};
+    Lexer sequential(Buffer { std::string_view { input } }, dfa);
+    sequential.setSkipUnmatched();
+    sequential.getAllTokens(expected);
+
+    TokenList tokens {};
+    Lexer lexer(Buffer { std::string_view { input } }, dfa);
+    lexer.setSkipUnmatched();
+    lexer.getAllTokens(tokens, 4);
+    EXPECT_EQ(tokens.kinds, expected.kinds);
+    EXPECT_EQ(tokens.offsets, expected.offsets);
+    EXPECT_EQ(tokens.lengths, expected.lengths);
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
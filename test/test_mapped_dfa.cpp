@@ -0,0 +1,121 @@
+#include <Lexer.hpp>
+#include <MappedDFA.hpp>
+#include <Synthetic.hpp>
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <iterator>
+
+template <typename lexer_t>
+static std::vector<std::pair<std::string, std::string>> tokenize(lexer_t& lexer)
+{
+    std::vector<std::pair<std::string, std::string>> tokens {};
+    while (auto token = lexer.nextToken())
+        tokens.emplace_back(token->type, token->value);
+    return tokens;
+}
+
+static std::string readFile(const std::string& filename)
+{
+    std::ifstream fin { filename, std::ios_base::in | std::ios_base::binary };
+    return { std::istreambuf_iterator<char> { fin }, {} };
+}
+
+static void writeFile(const std::string& filename, const std::string& data)
+{
+    std::ofstream fout { filename, std::ios_base::out | std::ios_base::binary };
+    fout << data;
+}
+
+class MappedDFATest: public ::testing::Test
+{
+protected:
+    static constexpr auto filename = "test_mapped_dfa.bin";
+    Synthetic::rules_t rules { Synthetic::makeGrammar(64) };
+    DFA dfa { NFA::fromRules(rules) };
+
+    MappedDFATest()
+    {
+        dfa.minimal();
+        EXPECT_TRUE(dfa.saveBinaryTo(filename));
+    }
+
+    ~MappedDFATest() override
+    {
+        std::remove(filename);
+    }
+};
+
+TEST_F(MappedDFATest, sameTablesAsDFA)
+{
+    MappedDFA mapped { filename };
+    ASSERT_TRUE(mapped.isValid());
+    EXPECT_EQ(mapped.getStateCount(), dfa.getStateCount());
+    EXPECT_EQ(mapped.getClassCount(), dfa.getClassCount());
+    EXPECT_EQ(mapped.getStartState(), dfa.getStartState());
+    EXPECT_EQ(mapped.getDeadState(), dfa.getDeadState());
+    EXPECT_EQ(mapped.getTokenCount(), dfa.getTokenNames().size());
+    for (FSA::kind_t kind = 0; kind < mapped.getTokenCount(); ++kind)
+        EXPECT_EQ(mapped.getTokenName(kind), dfa.getTokenName(kind));
+
+    for (FSA::state_t state = 0; state <= dfa.getStateCount(); ++state) {
+        EXPECT_EQ(mapped.getAcceptKind(state), dfa.getAcceptKind(state));
+        for (int byte = 0; byte < 256; ++byte) {
+            const auto ch = static_cast<FSA::char_t>(byte);
+            EXPECT_EQ(mapped.getNextState(state, ch), dfa.getNextState(state, ch));
+        }
+    }
+}
+
+TEST_F(MappedDFATest, sameTokensAsDFA)
+{
+    const auto input = Synthetic::makeText(rules, { .size = 4096 });
+    Lexer lexer(Buffer { input }, dfa);
+    MappedLexer mapped_lexer(Buffer { input }, MappedDFA { filename });
+    EXPECT_EQ(tokenize(mapped_lexer), tokenize(lexer));
+}
+
+TEST_F(MappedDFATest, corruptedPayloadRejected)
+{
+    auto data = readFile(filename);
+    data.back() ^= 1;
+    writeFile(filename, data);
+    EXPECT_FALSE(MappedDFA { filename }.isValid());
+    // the header is still fine, only the checksum catches it
+    EXPECT_TRUE(MappedDFA(filename, false).isValid());
+}
+
+TEST_F(MappedDFATest, badHeaderRejected)
+{
+    const auto data = readFile(filename);
+
+    auto bad_magic = data;
+    bad_magic[0] = 'X';
+    writeFile(filename, bad_magic);
+    EXPECT_FALSE(MappedDFA { filename }.isValid());
+
+    auto bad_version = data;
+    bad_version[sizeof(BinaryFormat::MAGIC)] += 1;
+    writeFile(filename, bad_version);
+    EXPECT_FALSE(MappedDFA { filename }.isValid());
+
+    writeFile(filename, data.substr(0, data.size() - 1));
+    EXPECT_FALSE(MappedDFA(filename, false).isValid());
+
+    writeFile(filename, "");
+    EXPECT_FALSE(MappedDFA { filename }.isValid());
+}
+
+TEST_F(MappedDFATest, missingFileRejected)
+{
+    std::remove(filename);
+    EXPECT_FALSE(MappedFile { filename }.isOpen());
+    EXPECT_FALSE(MappedDFA { filename }.isValid());
+    EXPECT_FALSE(MappedDFA(filename, false).isValid());
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -1,5 +1,7 @@
+#include <DFA.hpp>
 #include <NFA.hpp>
 #include <gtest/gtest.h>
+#include <random>
 
 NFA::str_t test_str = "a+b";
 
@@ -38,6 +40,143 @@ TEST_F(NFATest, getReachedStates)
     }
 }
 
+TEST(NFAUnion, localStateIds)
+{
+    NFA::str_t re1 = "ab", re2 = "c";
+    NFA lhs(re1), rhs(re2);
+    ASSERT_EQ(lhs.getStateCount(), 4);
+    ASSERT_EQ(rhs.getStateCount(), 2);
+
+    lhs = lhs + rhs;
+    EXPECT_EQ(lhs.getStateCount(), 8);
+    EXPECT_EQ(lhs.getStartState(), 6);
+    EXPECT_EQ(lhs.getFinalState(), 7);
+    EXPECT_EQ(*lhs.getReachedStates(lhs.getStartState()), (NFA::state_set_t { 0, 4, 6 }));
+    EXPECT_EQ(*lhs.getReachedStates(4, 'c'), (NFA::state_set_t { 5, 7 }));
+}
+
+TEST(NFAUnion, emptyUnionIsTheOther)
+{
+    NFA::str_t re = "ab";
+    NFA nfa, rhs(re);
+    nfa = nfa + rhs;
+    EXPECT_EQ(nfa.getStateCount(), rhs.getStateCount());
+    EXPECT_EQ(nfa.getStartState(), rhs.getStartState());
+    EXPECT_FALSE(nfa.hasFinalState(*nfa.getReachedStates(nfa.getStartState())));
+}
+
+// the union with itself copies the other side first
+TEST(NFAUnion, selfUnion)
+{
+    NFA::str_t regex = "ab|c", info = "T";
+    NFA nfa(regex, info, 1);
+    const auto state_count = nfa.getStateCount();
+    nfa + nfa;
+    EXPECT_EQ(nfa.getStateCount(), 2 * state_count + 2);
+    for (auto str : { "ab", "c" })
+        EXPECT_TRUE(nfa.match(str)) << str;
+    EXPECT_FALSE(nfa.match("abc"));
+}
+
+TEST(NFAClosure, epsilonCyclesShareTheClosure)
+{
+    // nested stars make epsilon cycles
+    NFA::str_t re = "(a*|b?)*c";
+    NFA nfa(re);
+
+    for (NFA::state_t state = 0; state < nfa.getStateCount(); ++state) {
+        // walk the epsilon edges directly
+        NFA::state_set_t expected { state };
+        std::vector<NFA::state_t> stack { state };
+        while (!stack.empty()) {
+            auto cur = stack.back();
+            stack.pop_back();
+            for (auto next : nfa.getState(cur).epsilon)
+                if (next != NFA::INVALID_STATE && expected.insert(next).second)
+                    stack.push_back(next);
+        }
+
+        auto closure = nfa.getEpsilonClosure(state);
+        EXPECT_TRUE(std::ranges::is_sorted(closure));
+        EXPECT_EQ(NFA::state_set_t(closure.begin(), closure.end()), expected) << state;
+    }
+}
+
+TEST(NFAClosure, cacheFollowsTheUnion)
+{
+    NFA::str_t re1 = "ab", re2 = "c";
+    NFA lhs(re1), rhs(re2);
+    EXPECT_EQ(lhs.getEpsilonClosure(lhs.getStartState()).size(), 1);
+
+    lhs = lhs + rhs;
+    auto closure = lhs.getEpsilonClosure(lhs.getStartState());
+    EXPECT_EQ(NFA::state_set_t(closure.begin(), closure.end()), (NFA::state_set_t { 0, 4, 6 }));
+}
+
+TEST(NFAMatch, wholeString)
+{
+    NFA::str_t regex = "(a|b)*abb(c?)";
+    NFA nfa(regex);
+    for (auto str : { "abb", "aabb", "babbc", "ababb" })
+        EXPECT_TRUE(nfa.match(str)) << str;
+    for (auto str : { "", "ab", "abbcc", "abba", "cabb" })
+        EXPECT_FALSE(nfa.match(str)) << str;
+    EXPECT_FALSE(NFA {}.match(""));
+}
+
+TEST(NFAMatch, nullable)
+{
+    NFA::str_t regex = "a*(b|c)?";
+    NFA nfa(regex);
+    for (auto str : { "", "a", "aaab", "c" })
+        EXPECT_TRUE(nfa.match(str)) << str;
+    for (auto str : { "bc", "ba", "d" })
+        EXPECT_FALSE(nfa.match(str)) << str;
+}
+
+// the union keeps the postfix of both sides, and the cached matcher is rebuilt
+TEST(NFAMatch, union)
+{
+    NFA::str_t re1 = "ab+", re2 = "c(d|e)*", info1 = "AB", info2 = "CD";
+    NFA nfa(re1, info1);
+    EXPECT_TRUE(nfa.match("abb"));
+    EXPECT_FALSE(nfa.match("cde"));
+
+    NFA tmp(re2, info2);
+    nfa = nfa + tmp;
+    for (auto str : { "ab", "abbb", "c", "cdeed" })
+        EXPECT_TRUE(nfa.match(str)) << str;
+    for (auto str : { "a", "abc", "dc" })
+        EXPECT_FALSE(nfa.match(str)) << str;
+}
+
+// one word, several words [union tables] and past MAX_TABLE_WORDS, checked against the DFA
+TEST(NFAMatch, sameAsDFA)
+{
+    NFA::rules_t rules {};
+    for (FSA::str_t regex : { "(a|b)*a(a|b)(a|b)(a|b)", "(ab|ba)+c?", "a(b|c)*d+", "((a|b)(c|d))*e" })
+        rules.emplace(regex, std::make_pair(1, regex));
+    auto nfa = NFA::fromRules(rules);
+
+    std::mt19937 rng { 1 };
+    for (int i = 0; i < 6; ++i) {
+        DFA dfa(nfa);
+        for (int j = 0; j < 500; ++j) {
+            std::string str {};
+            for (auto length = rng() % 10; length--;)
+                str += "abcde"[rng() % 5];
+
+            auto state = dfa.getStartState();
+            for (auto ch : str)
+                state = dfa.getNextState(state, ch);
+            EXPECT_EQ(nfa.match(str), dfa.isFinalState(state)) << str;
+        }
+
+        NFA tmp = nfa;
+        nfa = nfa + tmp;
+    }
+}
+
 // FIXME:
 // TEST_F(NFATest, getReachedStatesWithStateSetChar)
 // {
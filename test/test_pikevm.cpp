@@ -0,0 +1,103 @@
+#include <Lexer.hpp>
+#include <PikeVM.hpp>
+#include <Synthetic.hpp>
+#include <gtest/gtest.h>
+
+TEST(SparseSet, insertAndClear)
+{
+    SparseSet set { 8 };
+    EXPECT_TRUE(set.insert(3));
+    EXPECT_TRUE(set.insert(5));
+    EXPECT_FALSE(set.insert(3));
+    EXPECT_TRUE(set.contains(5));
+    EXPECT_FALSE(set.contains(4));
+    EXPECT_EQ(set.size(), 2u);
+
+    set.clear();
+    EXPECT_TRUE(set.empty());
+    EXPECT_FALSE(set.contains(3));
+    EXPECT_TRUE(set.insert(5));
+    EXPECT_EQ(*set.begin(), 5u);
+}
+
+TEST(PikeVM, longestMatchAndPriority)
+{
+    PikeVM vm { NFA::fromRules({
+        {"if",           { 2, "IF" }},
+        { "(i|f|x)+",    { 1, "ID" }},
+        { "=|==",        { 1, "OP" }},
+        { "(x|y)(x|y)?", { 1, "XY" }},
+    }) };
+    auto check = [&vm](std::string_view input, std::string_view type, std::size_t length) {
+        auto [kind, matched] = vm.longestMatch(input);
+        ASSERT_NE(kind, FSA::INVALID_KIND) << input;
+        EXPECT_EQ(vm.getTokenName(kind), type) << input;
+        EXPECT_EQ(matched, length) << input;
+    };
+
+    check("if", "IF", 2);
+    check("iff", "ID", 3);
+    check("==x", "OP", 2);
+    // ID and XY both accept "xx" with the same priority, the first rule of the NFA wins
+    check("xx", "ID", 2);
+    check("xy=", "XY", 2);
+    EXPECT_EQ(vm.longestMatch("#").kind, FSA::INVALID_KIND);
+    EXPECT_EQ(vm.longestMatch("").kind, FSA::INVALID_KIND);
+}
+
+TEST(PikeVM, sameTokensAsDFA)
+{
+    const auto rules = Synthetic::makeGrammar(200);
+    const auto nfa = NFA::fromRules(rules);
+    const auto text = Synthetic::makeText(rules, { .size = 32 << 10 });
+
+    DFA dfa(nfa);
+    Lexer lexer(Buffer { std::string_view { text } }, dfa);
+    TokenList expected {};
+    lexer.getAllTokens(expected);
+
+    PikeVM vm { nfa };
+    TokenList tokens {};
+    EXPECT_EQ(vm.tokenize(text, tokens), text.size());
+    EXPECT_EQ(tokens.offsets, expected.offsets);
+    EXPECT_EQ(tokens.lengths, expected.lengths);
+    ASSERT_EQ(tokens.size(), expected.size());
+    for (std::size_t i = 0; i < tokens.size(); ++i)
+        ASSERT_EQ(vm.getTokenName(tokens.kinds[i]), dfa.getTokenName(expected.kinds[i])) << i;
+}
+
+// a shadowed rule gets a kind in the VM but not in the DFA, only the names agree
+TEST(PikeVM, shadowedRuleKinds)
+{
+    const auto nfa = NFA::fromRules({
+        {"a",    { 2, "HIGH" }},
+        { "(a)", { 1, "A_LOW" }},
+    });
+    DFA dfa(nfa);
+    PikeVM vm { nfa };
+
+    const auto state = dfa.getNextState(dfa.getStartState(), 'a');
+    const auto [kind, length] = vm.longestMatch("a");
+    EXPECT_EQ(length, 1u);
+    EXPECT_EQ(vm.getTokenName(kind), "HIGH");
+    EXPECT_EQ(dfa.getTokenName(dfa.getAcceptKind(state)), "HIGH");
+    EXPECT_EQ(vm.getTokenNames().size(), 2u);
+    EXPECT_EQ(dfa.getTokenNames().size(), 1u);
+}
+
+TEST(PikeVM, stopsAtUnmatchedInput)
+{
+    PikeVM vm { NFA::fromRules({
+        {"ab",    { 1, "AB" }},
+        { "c+",   { 1, "C" } },
+    }) };
+    TokenList tokens {};
+    EXPECT_EQ(vm.tokenize("abccab#ab", tokens), 6u);
+    EXPECT_EQ(tokens.size(), 3u);
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
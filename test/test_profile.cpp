@@ -0,0 +1,93 @@
+// the instrumentation is what is tested, so it's compiled in whatever the build config is
+#ifndef LEXER_PROFILE
+    #define LEXER_PROFILE
+#endif
+#include <Lexer.hpp>
+#include <Profile.hpp>
+#include <gtest/gtest.h>
+
+PROFILE_ALLOCATION_HOOK()
+
+class ProfileTest: public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        Profile::Profiler::get().clear();
+    }
+
+    static void build()
+    {
+        DFA dfa(NFA::fromRules({
+            {"(a|b)*c", { 1, "ABC" }},
+            { "ab",     { 2, "AB" } },
+        }));
+        dfa.minimal();
+
+        Lexer lexer(Buffer { std::string_view { "abcabababc" } }, dfa);
+        TokenList tokens {};
+        lexer.getAllTokens(tokens);
+    }
+};
+
+TEST_F(ProfileTest, recordsEveryPhase)
+{
+    build();
+    const auto phases = Profile::Profiler::get().getPhases();
+    for (auto name : { "regex.concat",
+                       "regex.postfix",
+                       "nfa.thompson",
+                       "nfa.union",
+                       "dfa.subset",
+                       "dfa.compile",
+                       "dfa.minimal",
+                       "lexer.scan" }) {
+        ASSERT_TRUE(phases.contains(name)) << name;
+        EXPECT_GT(phases.at(name).calls, 0u) << name;
+    }
+    EXPECT_EQ(phases.at("regex.concat").calls, 2u);
+    EXPECT_EQ(phases.at("dfa.compile").calls, 2u);
+    EXPECT_GT(phases.at("dfa.subset").allocations, 0u);
+}
+
+TEST_F(ProfileTest, countsStatesAndTokens)
+{
+    build();
+    const auto counters = Profile::Profiler::get().getCounters();
+    EXPECT_GT(counters.at("nfa.states"), 0u);
+    EXPECT_GT(counters.at("nfa.transitions"), counters.at("nfa.states") / 2);
+    EXPECT_GE(counters.at("dfa.states"), counters.at("dfa.minimal_states"));
+    // abc | abababc
+    EXPECT_EQ(counters.at("lexer.tokens"), 2u);
+    EXPECT_EQ(counters.at("lexer.bytes"), 10u);
+}
+
+TEST_F(ProfileTest, nextTokenCountsAreFlushedAtTheEnd)
+{
+    FSA::str_t regex { "a|b" }, info { "AB" };
+    DFA dfa(NFA(regex, info, 1));
+    Lexer lexer(Buffer { std::string_view { "abba" } }, dfa);
+    ASSERT_TRUE(lexer.nextToken());
+    EXPECT_FALSE(Profile::Profiler::get().getCounters().contains("lexer.tokens"));
+
+    while (lexer.nextToken()) { }
+    const auto counters = Profile::Profiler::get().getCounters();
+    EXPECT_EQ(counters.at("lexer.tokens"), 4u);
+    EXPECT_EQ(counters.at("lexer.bytes"), 4u);
+}
+
+TEST_F(ProfileTest, jsonReport)
+{
+    build();
+    const auto json = Profile::Profiler::get().toJson();
+    EXPECT_NE(json.find("\"phases\": {"), std::string::npos);
+    EXPECT_NE(json.find("\"dfa.subset\": { \"calls\": 1, \"seconds\": "), std::string::npos);
+    EXPECT_NE(json.find("\"lexer.tokens\": 2"), std::string::npos);
+    EXPECT_EQ(std::count(json.begin(), json.end(), '{'), std::count(json.begin(), json.end(), '}'));
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,62 @@
+#include <Simd.hpp>
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+
+using table_t = std::array<bool, Simd::RangeSet::ALPHABET_SIZE>;
+
+static table_t makeTable(std::string_view bytes)
+{
+    table_t table {};
+    for (auto ch : bytes)
+        table[static_cast<unsigned char>(ch)] = true;
+    return table;
+}
+
+TEST(RangeSet, containsTheTable)
+{
+    auto identifier = makeTable("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_");
+    auto set = Simd::RangeSet::fromTable(identifier);
+    ASSERT_TRUE(set);
+    for (int byte = 0; byte < 256; ++byte)
+        EXPECT_EQ(set->contains(static_cast<char>(byte)), identifier[byte]) << byte;
+
+    // everything but a quote and a backslash is kept as a complement
+    table_t string_body {};
+    string_body.fill(true);
+    string_body['"'] = string_body['\\'] = false;
+    set = Simd::RangeSet::fromTable(string_body);
+    ASSERT_TRUE(set);
+    for (int byte = 0; byte < 256; ++byte)
+        EXPECT_EQ(set->contains(static_cast<char>(byte)), string_body[byte]) << byte;
+}
+
+TEST(RangeSet, tooManyRanges)
+{
+    EXPECT_FALSE(Simd::RangeSet::fromTable(makeTable("acegikmoqsuw")));
+}
+
+TEST(RangeSet, countPrefixAgreesWithContains)
+{
+    auto set = Simd::RangeSet::fromTable(makeTable(" \t\r\n"));
+    ASSERT_TRUE(set);
+
+    std::mt19937 rng { 42 };
+    for (std::size_t length = 0; length < 100; ++length) {
+        for (std::size_t run = 0; run <= length; ++run) {
+            std::string data(run, ' ');
+            for (std::size_t i = run; i < length; ++i)
+                data += " \t\r\nx"[rng() % 5];
+            if (run < length)
+                data[run] = 'x';
+
+            EXPECT_EQ(set->countPrefix(data), run) << length;
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,75 @@
+#include <Lexer.hpp>
+#include <Synthetic.hpp>
+#include <gtest/gtest.h>
+#include <random>
+
+TEST(Synthetic, grammarHasTheRuleCount)
+{
+    for (std::size_t rule_count : { 6, 10, 100, 1000 }) {
+        auto rules = Synthetic::makeGrammar(rule_count);
+        EXPECT_EQ(rules.size(), rule_count);
+
+        FSA::set_t<FSA::str_t> types {};
+        for (auto& [regex, value] : rules)
+            types.insert(value.second);
+        EXPECT_EQ(types.size(), rule_count);
+    }
+    EXPECT_EQ(Synthetic::makeGrammar(100), Synthetic::makeGrammar(100));
+}
+
+TEST(Synthetic, samplesMatchTheRule)
+{
+    std::mt19937 rng { 3 };
+    for (auto& [regex, value] : Synthetic::makeGrammar(60)) {
+        DFA dfa(NFA::fromRules({
+            {regex, value}
+        }));
+        Synthetic::Sampler sampler { regex };
+        for (int i = 0; i < 20; ++i) {
+            std::string sample {};
+            sampler.sample(rng, sample);
+
+            auto state = dfa.getStartState();
+            for (auto ch : sample)
+                state = dfa.getNextState(state, ch);
+            EXPECT_TRUE(dfa.isFinalState(state)) << regex << " : " << sample;
+        }
+    }
+}
+
+TEST(Synthetic, corpusMatchesTheGrammar)
+{
+    auto rules = Synthetic::makeGrammar(100);
+    auto text = Synthetic::makeText(rules, { .size = 64 << 10 });
+    EXPECT_GE(text.size(), 64u << 10);
+
+    DFA dfa(NFA::fromRules(rules));
+    Lexer lexer(Buffer { std::string_view { text } }, dfa);
+    std::string joined {};
+    while (auto token = lexer.nextToken())
+        joined += token->value;
+    EXPECT_EQ(joined, text);
+}
+
+TEST(Synthetic, noiseIsSkipped)
+{
+    auto rules = Synthetic::makeGrammar(100);
+    auto text = Synthetic::makeText(rules, { .size = 64 << 10, .noise_ratio = 0.5 });
+    EXPECT_NE(text.find_first_of(Synthetic::NOISE), std::string::npos);
+
+    DFA dfa(NFA::fromRules(rules));
+    Lexer lexer(Buffer { std::string_view { text } }, dfa);
+    lexer.setSkipUnmatched();
+    std::string joined {};
+    while (auto token = lexer.nextToken())
+        joined += token->value;
+
+    std::erase_if(text, [](char ch) { return Synthetic::NOISE.find(ch) != std::string_view::npos; });
+    EXPECT_EQ(joined, text);
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -7,8 +7,7 @@ add_rules('mode.debug', 'mode.release')
 add_requires(
     'fmt',
     'gtest',
-    'benchmark', -- TODO : add benchmark
-    'range-v3'   -- TODO :
+    'benchmark'
 )
 add_includedirs 'include'
 set_languages 'cxxlatest'
@@ -25,7 +24,28 @@ target = function(name)
 end
 
 
-add_packages('fmt', 'range-v3')
+add_packages('fmt')
+add_syslinks('pthread')
+
+-- the lexer scans self loop runs with SSE2 by default, AVX2 on request [xmake f --avx2=y]
+option('avx2')
+    set_default(false)
+    set_showmenu(true)
+    set_description('Build with AVX2 for the vectorized lexer fast path')
+option_end()
+if has_config('avx2') then
+    add_vectorexts('avx2')
+end
+
+-- per-phase timing and allocation counts, see include/Profile.hpp [xmake f --profile=y]
+option('profile')
+    set_default(false)
+    set_showmenu(true)
+    set_description('Build with the instrumentation of lexer_generator --profile=<report.json>')
+option_end()
+if has_config('profile') then
+    add_defines('LEXER_PROFILE')
+end
 -- Debug模式设置
 if is_mode 'debug' then
     set_optimize 'none'
@@ -48,6 +68,11 @@ target("lexer_generator")
     set_kind("binary")
     add_files("src/main.cpp")
 
+-- synthetic grammars and inputs for benchmarking, see include/Synthetic.hpp
+target("synthetic")
+    set_kind("binary")
+    add_files("src/synthetic.cpp")
+
 
 -- INFO :
 --  ╭──────────────────────────────────────────────────────────╮
@@ -59,8 +84,24 @@ local test_cases = {
     },
     nfa = {
     },
+    dfa = {
+    },
     buffer = {
     },
+    lexer = {
+    },
+    simd = {
+    },
+    profile = {
+    },
+    pikevm = {
+    },
+    synthetic = {
+    },
+    mapped_dfa = {
+    },
+    grammar_cache = {
+    },
 }
 for name, option in pairs(test_cases) do
     local target_name = 'test_' .. name
@@ -76,6 +117,50 @@ for name, option in pairs(test_cases) do
     end
 end
 
+-- INFO :
+--  ╭──────────────────────────────────────────────────────────╮
+--  │                        Benchmark                         │
+--  ╰──────────────────────────────────────────────────────────╯
+-- xmake build -g bench && xmake run -g bench
+
+-- the demo grammar of lexer_generator, generated with both backends
+local function generate_lexers(target)
+    local generator = target:dep('lexer_generator'):targetfile()
+    local autogendir = target:autogendir()
+    os.mkdir(autogendir)
+    os.vrunv(generator, { path.join(autogendir, 'table_lexer.hpp'), '--table', 'table_lexer' })
+    os.vrunv(generator, { path.join(autogendir, 'direct_lexer.hpp'), '--direct', 'direct_lexer' })
+end
+
+local bench_cases = {
+    nfa = {
+    },
+    dfa = {
+    },
+    lexer = {
+    },
+    scaling = {
+    },
+    codegen = {
+        add_deps = 'lexer_generator',
+        before_build = generate_lexers,
+        on_load = function(target) target:add('includedirs', target:autogendir()) end,
+    },
+}
+for name, option in pairs(bench_cases) do
+    local target_name = 'bench_' .. name
+    target(target_name)
+        set_kind('binary')
+        set_group('bench')
+        add_files('bench/' .. target_name .. '.cpp')
+        add_packages('benchmark')
+        set_targetdir '$(projectdir)/bench/bin'
+
+    for method, opt in pairs(option) do
+        _G[method](opt)
+    end
+end
+
 task('debug')
     on_run(function()
         import('core.tool.compiler')